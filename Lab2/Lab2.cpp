@@ -1,9 +1,143 @@
 #include <cstdint>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
 #include "engine.h"
+#include "headless_backend.h"
+#include "profiler.h"
+#include "RasterSurface.h"
+
+static void print_usage(FILE* out)
+{
+	std::fprintf(out,
+	             "Usage: Lab2 [--headless discard|ring|stream] [--frames count] [--output path] [--workers count]\n"
+	             "            [--trace path] [--pacing uncapped|fixed|presenter] [--fps rate] [--in-flight count]\n"
+	             "            [--help]\n");
+}
+
+// Every flag but --help takes one value.
+static bool takes_value(const char* flag)
+{
+	static const char* const flags[] = {
+		"--headless", "--frames", "--output", "--workers", "--trace", "--pacing", "--fps", "--in-flight"
+	};
+	for (const char* known : flags)
+	{
+		if (std::strcmp(flag, known) == 0) return true;
+	}
+	return false;
+}
+
+// False unless text is a whole decimal number that fits.
+static bool parse_count(const char* text, uint32_t& value)
+{
+	char* end;
+	const unsigned long parsed = std::strtoul(text, &end, 10);
+	if (end == text || *end != '\0' || *text == '-' || parsed > UINT32_MAX) return false;
+	value = static_cast<uint32_t>(parsed);
+	return true;
+}
 
-int main()
+static bool parse_rate(const char* text, double& value)
 {
-    engine e{};
+	char* end;
+	const double parsed = std::strtod(text, &end);
+	if (end == text || *end != '\0' || !(parsed > 0)) return false;
+	value = parsed;
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	bool headless = false;
+	headless_options options{};
+	uint32_t workers = 0;
+	const char* trace = nullptr;
+	frame_schedule_options schedule{};
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* flag = argv[i];
+		if (std::strcmp(flag, "--help") == 0)
+		{
+			print_usage(stdout);
+			return 0;
+		}
+
+		if (!takes_value(flag))
+		{
+			std::fprintf(stderr, "Unknown argument: %s\n", flag);
+			print_usage(stderr);
+			return 1;
+		}
+		if (i + 1 == argc)
+		{
+			std::fprintf(stderr, "Missing value for %s\n", flag);
+			print_usage(stderr);
+			return 1;
+		}
+
+		const char* value = argv[++i];
+		bool valid = true;
+		if (std::strcmp(flag, "--headless") == 0)
+		{
+			headless = true;
+			if (std::strcmp(value, "discard") == 0) options.mode = headless_mode::discard;
+			else if (std::strcmp(value, "ring") == 0) options.mode = headless_mode::ring;
+			else if (std::strcmp(value, "stream") == 0) options.mode = headless_mode::stream;
+			else valid = false;
+		}
+		else if (std::strcmp(flag, "--frames") == 0)
+			valid = parse_count(value, options.frame_limit);
+		else if (std::strcmp(flag, "--output") == 0)
+			options.path = value;
+		else if (std::strcmp(flag, "--workers") == 0)
+			valid = parse_count(value, workers);
+		else if (std::strcmp(flag, "--trace") == 0)
+			trace = value;
+		else if (std::strcmp(flag, "--pacing") == 0)
+		{
+			if (std::strcmp(value, "uncapped") == 0) schedule.pacing = frame_pacing::uncapped;
+			else if (std::strcmp(value, "fixed") == 0) schedule.pacing = frame_pacing::fixed_rate;
+			else if (std::strcmp(value, "presenter") == 0) schedule.pacing = frame_pacing::presenter_driven;
+			else valid = false;
+		}
+		else if (std::strcmp(flag, "--fps") == 0)
+			valid = parse_rate(value, schedule.frame_rate);
+		else if (std::strcmp(flag, "--in-flight") == 0)
+			valid = parse_count(value, schedule.max_frames_in_flight);
+
+		if (!valid)
+		{
+			std::fprintf(stderr, "Invalid value for %s: %s\n", flag, value);
+			print_usage(stderr);
+			return 1;
+		}
+	}
+
+	// Tracing records every zone, the frame time summary comes with it.
+	profiler::set_enabled(trace != nullptr);
+
+	headless_backend backend{ options };
+	if (headless) RS_SetBackend(&backend);
+
+    engine e{ 500, 500, workers, schedule };
 	e.start();
+
+	// Frames may be streamed to stdout, keep the report out of the way.
+	if (headless)
+		std::fprintf(stderr, "%llu frames, %.1f fps\n", static_cast<unsigned long long>(backend.get_frame_count()),
+		             backend.get_frames_per_second());
+
+	if (trace)
+	{
+		const auto stats = profiler::get_frame_stats();
+		std::fprintf(stderr, "frame time over %u frames: mean %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+		             stats.frame_count, stats.mean_ms, stats.p50_ms, stats.p99_ms, stats.max_ms);
+
+		if (!profiler::write_chrome_trace(trace))
+			std::fprintf(stderr, "Could not write trace to %s\n", trace);
+	}
 }
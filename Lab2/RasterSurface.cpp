@@ -2,6 +2,10 @@
 // Author: L.Norri CD GX1 & GX2, FullSail University
 
 #include "RasterSurface.h"// definitions
+#include "surface_backend.h"
+#include "headless_backend.h"
+
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <wingdi.h>
@@ -17,13 +21,16 @@ std::thread						windowHandler;
 DWORD							windowHandlerID = -1;
 std::atomic_bool				windowClosed;
 const char*						windowTitle = nullptr;
-unsigned int*					bitmap = nullptr;
+const unsigned int*				bitmap = nullptr; // borrowed from RS_Update while presenting
 unsigned int					bitmapWidth = 0;
 unsigned int					bitmapHeight = 0;
 std::mutex						bitmapMutex;
 std::condition_variable			bitmapRedraw;
-std::future<unsigned int*>		bitmapAllocator;
+std::future<void>				windowReady;
 std::atomic_bool				bitmapPresent; 
+const unsigned int*				bitmapRects = nullptr; // changed rectangles of bitmap, nullptr paints it whole
+unsigned int					bitmapRectCount = 0;
+std::atomic_bool				windowExposed; // set when windows lost the window contents
 
 // Handles all windows messages (Messages may arrive cross-thread without a valid HWND)
 // hWnd may be set artifically due to cross-thread message posting (NULL HWNDs are ignored)
@@ -31,6 +38,17 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
 	switch (message)
 	{
+	case (WM_ERASEBKGND) :
+		return 1; // every pixel is painted by PresentFrame, erasing would only flicker
+	case (WM_PAINT) :
+		{
+			// the contents were damaged, the next frame has to be painted whole
+			PAINTSTRUCT paint;
+			BeginPaint(hWnd, &paint);
+			EndPaint(hWnd, &paint);
+			windowExposed = true;
+			return 0;
+		}
 	case (WM_DESTROY) :
 		{
 			windowClosed = true; // window closing, updates disabled
@@ -62,9 +80,23 @@ bool PresentFrame()
 		toDraw.bmiHeader.biPlanes = 1;
 		toDraw.bmiHeader.biBitCount = 32;
 		toDraw.bmiHeader.biCompression = BI_RGB;
-		// Draw to frontbuffer
-		SetDIBitsToDevice(windowDC, 0, 0, bitmapWidth, bitmapHeight, 0, 0, 0,
-			bitmapHeight, bitmap, &toDraw, DIB_RGB_COLORS);
+		// Draw to frontbuffer, only the changed rectangles when the window still shows the previous frame
+		if (bitmapRects && !windowExposed.exchange(false))
+		{
+			for (unsigned int i = 0; i < bitmapRectCount; ++i)
+			{
+				const unsigned int* rect = bitmapRects + i * 4;
+				// describe just the rows of the rectangle, so no source origin convention is involved
+				toDraw.bmiHeader.biHeight = -int(rect[3] - rect[1]);
+				SetDIBitsToDevice(windowDC, rect[0], rect[1], rect[2] - rect[0], rect[3] - rect[1], rect[0], 0, 0,
+					rect[3] - rect[1], bitmap + size_t(rect[1]) * bitmapWidth, &toDraw, DIB_RGB_COLORS);
+			}
+		}
+		else
+		{
+			SetDIBitsToDevice(windowDC, 0, 0, bitmapWidth, bitmapHeight, 0, 0, 0,
+				bitmapHeight, bitmap, &toDraw, DIB_RGB_COLORS);
+		}
 		// increase frame count and notify render thread to continue
 		bitmapPresent = false; // increase frame count
 		bitmapRedraw.notify_one(); // tell main thread to continue rendering
@@ -87,13 +119,10 @@ bool PresentFrame()
 
 // This thread will handle all updates to the window
 void ProcessRasterSurface(	unsigned int _width, unsigned int _height, 
-							std::promise<unsigned int*> bitmapInit)
+							std::promise<void> windowInit)
 {
-	// DIB pixel buffers may not be fragmented across heaps
-	// VirtualAlloc garuntees true memory contiguity (needed by SetDIBitsToDevice) 
-	unsigned int *frontbuffer = (unsigned int*)VirtualAlloc(nullptr, (_width * _height) << 2, 
-												MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
-	bitmapInit.set_value( frontbuffer ); // fufill promise
+	// frames are painted straight from the pixels handed to RS_Update, no front buffer is needed
+	windowInit.set_value(); // fufill promise
 	// Create a win32 window and manage it on this thread
 	WNDCLASSEX  wndClass;
 	ZeroMemory(&wndClass, sizeof(WNDCLASSEX));
@@ -139,8 +168,9 @@ void ProcessRasterSurface(	unsigned int _width, unsigned int _height,
 				PresentFrame();
 		}
 	}
-	// delete the front buffer "aka: bitmap" (before thread shuts down)
-	VirtualFree(frontbuffer, 0, MEM_RELEASE); bitmap = nullptr;
+	// no more frames can be painted, release anyone waiting on one
+	windowClosed = true;
+	bitmapRedraw.notify_one();
 	// deallocate window
 	UnregisterClassW(L"RasterSurfaceApplication", GetModuleHandleW(0));
 }
@@ -149,21 +179,22 @@ void ProcessRasterSurface(	unsigned int _width, unsigned int _height,
 BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlCode);
 
 // Spawns & manages a win32 window of the requested size. (the "RasterSurface") 
-bool RS_Initialize(	_In_z_ const char* _studentName,
+bool Win32_Initialize(	_In_z_ const char* _studentName,
 					_In_range_(1, 0xFFFF) unsigned int _width,
 					_In_range_(1, 0xFFFF) unsigned int _height)
 {
 	// Create a win32 window and manage it on another thread
 	bitmapPresent = false; // no bitmap is available yet
 	windowClosed = false; // window is being created
+	windowExposed = true; // nothing painted yet
 	windowTitle = _studentName; // prepended name
 	bitmapWidth = _width; // save x size
 	bitmapHeight = _height; // save y size
-	// bitmap creation will be fufilled on secondary thread. (allow immediate drawing)
-	std::promise<unsigned int*>	bitmapGen;
-	bitmapAllocator = bitmapGen.get_future();
+	// window creation will be fufilled on secondary thread. (allow immediate drawing)
+	std::promise<void>	windowGen;
+	windowReady = windowGen.get_future();
 	// handle messages & buffer updates on dedicated thread
-	windowHandler = std::thread( ProcessRasterSurface, _width, _height, std::move(bitmapGen) );
+	windowHandler = std::thread( ProcessRasterSurface, _width, _height, std::move(windowGen) );
 	windowHandlerID = GetThreadId(static_cast<HANDLE>(windowHandler.native_handle())); // what is the new thread's ID?
 	// allows gracefull exit when console window is closed
 	SetConsoleCtrlHandler(ConsoleCtrlHandler, TRUE);
@@ -172,39 +203,37 @@ bool RS_Initialize(	_In_z_ const char* _studentName,
 
 // Updates the RasterSurface with a block of raw XRGB pixel data.
 // Incoming data must 32bit pixels 8 bits per channel.
-bool RS_Update(	_In_reads_(_numPixels) const unsigned int *_argbPixels,
-				_In_range_(1, 0xFFFFFFFF) unsigned int _numPixels)
+bool Win32_Update(	_In_reads_(_numPixels) const unsigned int *_argbPixels,
+				_In_range_(1, 0xFFFFFFFF) unsigned int _numPixels,
+				const unsigned int *_rects = nullptr, unsigned int _numRects = 0)
 {
 	// Wait for the drawing surface to intialize
-	if (bitmapAllocator.valid())
-		bitmap = bitmapAllocator.get();// retreive allocated value (blocking)
-	// begin transfer
-	if (bitmap)
-	{	// track the current frame being rendered
-		static unsigned int internalCount = 0;
-		// if we have a valid window, lets transfer the memory block to the screen
-		{
-			std::unique_lock<std::mutex> pixelLock(bitmapMutex); // protect bitmap
-			// wait for last paint to occur if we are ahead
-			bitmapRedraw.wait( pixelLock, [&]() 
-			{ 
-				return !bitmapPresent || windowClosed;
-			} );
-			// if the window has been closed, allow no more updates
-			if (windowClosed) return false;
-			// copy bitmap data so we can continue to 
-			// draw while it is transfered to frontbuffer
-			memcpy_s(bitmap, _numPixels << 2, _argbPixels, _numPixels << 2);
-			// notify win32 thread we are ready to present the new image
-			bitmapPresent = true;
-		}
-		return true;
+	if (windowReady.valid())
+		windowReady.get(); // (blocking)
+	// if the window has been closed, allow no more updates
+	if (windowClosed) return false;
+	{
+		std::unique_lock<std::mutex> pixelLock(bitmapMutex); // protect bitmap
+		// paint straight from the incoming pixels, nothing is copied so this call only
+		// returns once the window is done reading them and the caller may reuse them
+		bitmap = _argbPixels;
+		bitmapRects = _rects;
+		bitmapRectCount = _numRects;
+		// notify win32 thread we are ready to present the new image
+		bitmapPresent = true;
+		bitmapRedraw.wait( pixelLock, [&]() 
+		{ 
+			return !bitmapPresent || windowClosed;
+		} );
+		bitmap = nullptr;
+		bitmapRects = nullptr;
+		if (windowClosed) return false;
 	}
-	return false;
+	return true;
 }
 
 // Deallocates the RasterSurface and cleans up any leftover memory.
-bool RS_Shutdown()
+bool Win32_Shutdown()
 {
 	// tell window to close
 	PostThreadMessageW(windowHandlerID, WM_DESTROY, 0, 0);
@@ -222,7 +251,85 @@ BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlCode)
 	// Cleanly exit in case of unclean close
 	if (ctrlCode == CTRL_BREAK_EVENT || ctrlCode == CTRL_CLOSE_EVENT ||
 		ctrlCode == CTRL_LOGOFF_EVENT || ctrlCode == CTRL_SHUTDOWN_EVENT)
-		RS_Shutdown(); // kill window and wait for shutdown
+		Win32_Shutdown(); // kill window and wait for shutdown
 	// allow other handlers to end process
 	return FALSE;
+}
+
+// Presents through the win32 window above, the default backend on windows.
+class win32_backend final : public surface_backend
+{
+public:
+	bool initialize(const char* title, uint32_t width, uint32_t height) override
+	{
+		return Win32_Initialize(title, width, height);
+	}
+
+	bool update(const uint32_t* pixels, uint32_t pixel_count) override
+	{
+		return Win32_Update(pixels, pixel_count);
+	}
+
+	bool update_region(const uint32_t* pixels, uint32_t pixel_count, const uint32_t* rects,
+	                   uint32_t rect_count) override
+	{
+		return Win32_Update(pixels, pixel_count, rects, rect_count);
+	}
+
+	bool shutdown() override
+	{
+		return Win32_Shutdown();
+	}
+};
+#endif
+
+// backend selected by RS_SetBackend, nullptr uses the platform default
+surface_backend*				activeBackend = nullptr;
+
+// The backend used when none has been selected.
+surface_backend& DefaultBackend()
+{
+#ifdef _WIN32
+	static win32_backend backend;
+#else
+	// no display to open a window on, frames are only counted
+	static headless_backend backend;
+#endif
+	return backend;
+}
+
+surface_backend& ActiveBackend()
+{
+	return activeBackend ? *activeBackend : DefaultBackend();
+}
+
+bool RS_Initialize(	_In_z_ const char* _studentName,
+					_In_range_(1, 0xFFFF) unsigned int _width,
+					_In_range_(1, 0xFFFF) unsigned int _height)
+{
+	return ActiveBackend().initialize(_studentName, _width, _height);
+}
+
+bool RS_Update(	_In_reads_(_numPixels) const unsigned int *_xrgbPixels,
+				_In_range_(1, 0xFFFFFFFF) unsigned int _numPixels)
+{
+	return ActiveBackend().update(_xrgbPixels, _numPixels);
+}
+
+bool RS_UpdateRegion(	_In_reads_(_numPixels) const unsigned int *_xrgbPixels,
+						_In_range_(1, 0xFFFFFFFF) unsigned int _numPixels,
+						_In_reads_(_numRects * 4) const unsigned int *_rects,
+						unsigned int _numRects)
+{
+	return ActiveBackend().update_region(_xrgbPixels, _numPixels, _rects, _numRects);
+}
+
+bool RS_Shutdown()
+{
+	return ActiveBackend().shutdown();
+}
+
+void RS_SetBackend(surface_backend* _backend)
+{
+	activeBackend = _backend;
 }
\ No newline at end of file
@@ -2,8 +2,17 @@
 // Author: L.Norri CD GX1 & GX2, FullSail University
 
 #pragma once
+#ifdef _WIN32
 // Microsoft source-code annotation language (SAL)
 #include <sal.h> 
+#else
+// SAL only exists on MSVC, the annotations compile away everywhere else.
+#define _In_z_
+#define _In_range_(lb, ub)
+#define _In_reads_(size)
+#endif
+
+class surface_backend;
 
 // Spawns & manages a win32 window of the requested size. (the "RasterSurface") 
 bool RS_Initialize( _In_z_ const char* _studentName,
@@ -12,8 +21,22 @@ bool RS_Initialize( _In_z_ const char* _studentName,
 
 // Updates the RasterSurface with a block of raw XRGB pixel data.
 // Incoming data must 32bit pixels 8 bits per channel.
+// The pixels are read in place (not copied) and must stay untouched until the call returns.
 bool RS_Update(	_In_reads_(_numPixels) const unsigned int *_xrgbPixels, 
 				_In_range_(1, 0xFFFFFFFF) unsigned int _numPixels);
 
+// RS_Update for a frame where only some rectangles changed since the previous one.
+// _rects holds _numRects rectangles as left, top, right and bottom pixel edges (right and bottom exclusive).
+// Backends that can't present part of a frame present all of it.
+bool RS_UpdateRegion(	_In_reads_(_numPixels) const unsigned int *_xrgbPixels,
+						_In_range_(1, 0xFFFFFFFF) unsigned int _numPixels,
+						_In_reads_(_numRects * 4) const unsigned int *_rects,
+						unsigned int _numRects);
+
 // Deallocates the RasterSurface and cleans up any leftover memory.
-bool RS_Shutdown();
\ No newline at end of file
+bool RS_Shutdown();
+
+// Selects the backend the three calls above forward to, must happen before RS_Initialize.
+// nullptr restores the platform default (win32 window on windows, headless elsewhere).
+// The backend is not owned by the RasterSurface and must outlive RS_Shutdown.
+void RS_SetBackend(surface_backend* _backend);
@@ -1,46 +1,49 @@
 #include "base_object.h"
 
+#include <algorithm>
 #include <utility>
 
 #include "engine_data.h"
+#include "geometry_stage.h"
 
-base_object::base_object(vertex* const vertices, uint32_t* const indices)
-	: vertices_(vertices),
-	  vertex_count_(0),
-	  indices_(indices), parent_(nullptr),
-	  world_matrix_(mat_4(vec4::zero(), vec4::zero(), vec4::zero(), {0, 0, 0, 1}))
+base_object::base_object(mesh_storage&& geometry, const mat_4& world_matrix): geometry_(std::move(geometry)),
+                                                                           world_matrix_(world_matrix)
 {
+	update_bounds();
 }
 
-base_object::base_object(vertex* const vertices, uint32_t const vertex_count, uint32_t* const indices,
-                         const mat_4& world_matrix): vertices_(vertices),
-                                                     vertex_count_(vertex_count),
-                                                     indices_(indices), parent_(nullptr),
-                                                     world_matrix_(world_matrix)
+base_object::base_object(const vertex* const vertices, uint32_t const vertex_count, const uint32_t* const indices,
+                         uint32_t const index_count, const mat_4& world_matrix): geometry_(vertex_count, index_count),
+                                                                                 world_matrix_(world_matrix)
 {
+	std::copy_n(vertices, vertex_count, geometry_.get_vertices());
+	std::copy_n(indices, index_count, geometry_.get_indices());
+	update_bounds();
 }
 
-base_object::~base_object()
+base_object::base_object(const base_object& other): geometry_(other.geometry_.clone()),
+                                                    bounds_(other.bounds_),
+                                                    world_matrix_(other.world_matrix_),
+                                                    relative_matrix_(other.relative_matrix_)
 {
-	delete[] vertices_;
-	delete[] indices_;
 }
 
-base_object::base_object(base_object&& other) noexcept: vertices_(other.vertices_),
-                                                        vertex_count_(other.vertex_count_),
-                                                        indices_(other.indices_), parent_(nullptr),
-                                                        world_matrix_(other.world_matrix_)
+base_object::base_object(base_object&& other) noexcept: geometry_(std::move(other.geometry_)),
+                                                        bounds_(other.bounds_),
+                                                        world_matrix_(other.world_matrix_),
+                                                        relative_matrix_(other.relative_matrix_)
 {
+	other.bounds_ = bounding_sphere();
 }
 
 base_object& base_object::operator=(const base_object& other)
 {
 	if (this == &other)
 		return *this;
-	vertices_ = other.vertices_;
-	vertex_count_ = other.vertex_count_;
-	indices_ = other.indices_;
+	geometry_ = other.geometry_.clone();
+	bounds_ = other.bounds_;
 	world_matrix_ = other.world_matrix_;
+	relative_matrix_ = other.relative_matrix_;
 	return *this;
 }
 
@@ -48,41 +51,59 @@ base_object& base_object::operator=(base_object&& other) noexcept
 {
 	if (this == &other)
 		return *this;
-	vertices_ = other.vertices_;
-	vertex_count_ = other.vertex_count_;
-	indices_ = other.indices_;
-	world_matrix_ = std::move(other.world_matrix_);
+	geometry_ = std::move(other.geometry_);
+	bounds_ = other.bounds_;
+	world_matrix_ = other.world_matrix_;
+	relative_matrix_ = other.relative_matrix_;
+	other.bounds_ = bounding_sphere();
 	return *this;
 }
 
 vertex* base_object::get_vertices() const
 {
-	return vertices_;
+	return geometry_.get_vertices();
 }
 
-void base_object::set_vertices(vertex* const vertices)
+uint32_t base_object::get_vertex_count() const
 {
-	vertices_ = vertices;
+	return geometry_.get_vertex_count();
 }
 
-uint32_t base_object::get_vertex_count() const
+uint32_t* base_object::get_indices() const
 {
-	return vertex_count_;
+	return geometry_.get_indices();
 }
 
-void base_object::set_vertex_count(const uint32_t vertex_count)
+uint32_t base_object::get_index_count() const
 {
-	vertex_count_ = vertex_count;
+	return geometry_.get_index_count();
 }
 
-uint32_t* base_object::get_indices() const
+const mesh_storage& base_object::get_geometry() const
+{
+	return geometry_;
+}
+
+void base_object::set_geometry(mesh_storage&& geometry)
 {
-	return indices_;
+	geometry_ = std::move(geometry);
+	update_bounds();
 }
 
-void base_object::set_indices(uint32_t* const indices)
+const bounding_sphere& base_object::get_bounds() const
 {
-	indices_ = indices;
+	return bounds_;
+}
+
+mesh_view base_object::get_view() const
+{
+	mesh_view view;
+	view.vertices = geometry_.get_vertices();
+	view.vertex_count = geometry_.get_vertex_count();
+	view.indices = geometry_.get_indices();
+	view.index_count = geometry_.get_index_count();
+	view.bounds = bounds_;
+	return view;
 }
 
 mat_4 base_object::get_world_matrix() const
@@ -95,11 +116,41 @@ void base_object::set_world_matrix(const mat_4& world_matrix)
 	this->world_matrix_ = world_matrix;
 }
 
+mat_4 base_object::get_relative_matrix() const
+{
+	return relative_matrix_;
+}
+
+void base_object::set_relative_matrix(const mat_4& relative_matrix)
+{
+	relative_matrix_ = relative_matrix;
+}
+
+base_object* base_object::get_parent() const
+{
+	return parent_;
+}
+
+void base_object::set_parent(base_object* const parent)
+{
+	parent_ = parent;
+}
+
+soa_mesh base_object::build_mesh() const
+{
+	return soa_mesh(geometry_.get_vertices(), geometry_.get_vertex_count());
+}
+
+void base_object::update_bounds()
+{
+	bounds_ = geometry_stage::get_bounds(geometry_.get_vertices(), geometry_.get_vertex_count());
+}
+
 bool operator==(const base_object& lhs, const base_object& rhs)
 {
-	return lhs.vertices_ == rhs.vertices_
-		&& lhs.vertex_count_ == rhs.vertex_count_
-		&& lhs.indices_ == rhs.indices_
+	return lhs.get_vertices() == rhs.get_vertices()
+		&& lhs.get_vertex_count() == rhs.get_vertex_count()
+		&& lhs.get_indices() == rhs.get_indices()
 		&& lhs.world_matrix_ == rhs.world_matrix_;
 }
 
@@ -110,17 +161,17 @@ bool operator!=(const base_object& lhs, const base_object& rhs)
 
 bool operator<(const base_object& lhs, const base_object& rhs)
 {
-	if (lhs.vertices_ < rhs.vertices_)
+	if (lhs.get_vertices() < rhs.get_vertices())
 		return true;
-	if (rhs.vertices_ < lhs.vertices_)
+	if (rhs.get_vertices() < lhs.get_vertices())
 		return false;
-	if (lhs.vertex_count_ < rhs.vertex_count_)
+	if (lhs.get_vertex_count() < rhs.get_vertex_count())
 		return true;
-	if (rhs.vertex_count_ < lhs.vertex_count_)
+	if (rhs.get_vertex_count() < lhs.get_vertex_count())
 		return false;
-	if (lhs.indices_ < rhs.indices_)
+	if (lhs.get_indices() < rhs.get_indices())
 		return true;
-	if (rhs.indices_ < lhs.indices_)
+	if (rhs.get_indices() < lhs.get_indices())
 		return false;
 	return lhs.world_matrix_ < rhs.world_matrix_;
 }
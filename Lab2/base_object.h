@@ -2,19 +2,25 @@
 #include <cstdint>
 
 #include "engine_data.h"
+#include "mesh_pool.h"
+#include "soa_mesh.h"
 
+// Owns its geometry through a mesh_storage: copies duplicate it, moves hand it over and leave the source empty.
+// The parent is never copied or moved, a new object has none and an assigned one keeps its own.
 class base_object
 {
 public:
 	base_object() = default;
 
-	base_object(vertex* const vertices, uint32_t* const indices);
+	explicit base_object(mesh_storage&& geometry, const mat_4& world_matrix = mat_4::identity());
 
-	base_object(vertex* const vertices, uint32_t const vertex_count, uint32_t* const indices, const mat_4& world_matrix);
+	// Copies the arrays into pooled storage, the caller keeps ownership of its own.
+	base_object(const vertex* const vertices, uint32_t const vertex_count, const uint32_t* const indices,
+	            uint32_t const index_count, const mat_4& world_matrix);
 
-	~base_object();
+	~base_object() = default;
 
-	base_object(const base_object& other) = default;
+	base_object(const base_object& other);
 
 	base_object(base_object&& other) noexcept;
 
@@ -34,26 +40,48 @@ public:
 
 	friend bool operator>=(const base_object& lhs, const base_object& rhs);
 
+	// Vertices may be edited in place, call update_bounds afterwards.
 	vertex* get_vertices() const;
 
-	void set_vertices(vertex* const vertices);
-
 	uint32_t get_vertex_count() const;
 
-	void set_vertex_count(const uint32_t vertex_count);
-
 	uint32_t* get_indices() const;
 
-	void set_indices(uint32_t* const indices);
+	// Number of indices, three per triangle.
+	uint32_t get_index_count() const;
+
+	const mesh_storage& get_geometry() const;
+
+	// Replaces the geometry, the old storage goes back to its pool.
+	void set_geometry(mesh_storage&& geometry);
+
+	// Object space sphere around the vertices, refreshed whenever the geometry is replaced.
+	const bounding_sphere& get_bounds() const;
+
+	void update_bounds();
+
+	mesh_view get_view() const;
 
 	mat_4 get_world_matrix() const;
 
 	void set_world_matrix(const mat_4& world_matrix);
 
+	mat_4 get_relative_matrix() const;
+
+	void set_relative_matrix(const mat_4& relative_matrix);
+
+	base_object* get_parent() const;
+
+	void set_parent(base_object* const parent);
+
+	// Structure of arrays copy of the current vertices for the batched transform path.
+	// Built on request rather than stored, so it can never lag behind the geometry.
+	soa_mesh build_mesh() const;
+
 private:
-	vertex* vertices_ = nullptr;
-	uint32_t vertex_count_{};
-	uint32_t* indices_ = nullptr;
+	mesh_storage geometry_;
+
+	bounding_sphere bounds_;
 
 	base_object* parent_ = nullptr;
 
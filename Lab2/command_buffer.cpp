@@ -0,0 +1,370 @@
+#include "command_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+#include "base_object.h"
+#include "engine_data.h"
+
+struct command_header
+{
+	command_type type;
+
+	// Index into the buffer's states, draws only.
+	uint32_t state;
+};
+
+struct pixel_command
+{
+	uint32_t pixel;
+	uint32_t x;
+	uint32_t y;
+};
+
+struct line_command
+{
+	double start[2];
+	double end[2];
+	uint32_t color;
+};
+
+// Followed by count start and end points as x, y pairs.
+struct lines_command
+{
+	uint32_t count;
+	uint32_t color;
+};
+
+// Followed by vertex_count vertices, then count * 3 indices.
+struct triangles_command
+{
+	uint32_t count;
+	uint32_t vertex_count;
+};
+
+struct object_command
+{
+	const base_object* object;
+	double matrix[4][4];
+};
+
+struct mesh_command
+{
+	const vertex* vertices;
+	const uint32_t* indices;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	double center[3];
+	double radius;
+	double matrix[4][4];
+};
+
+// Records are padded so every payload starts 8 byte aligned, which covers vertices and doubles.
+static constexpr size_t record_alignment = 8;
+
+template <typename T>
+static T read(const unsigned char* data)
+{
+	T value;
+	std::memcpy(&value, data, sizeof(T));
+	return value;
+}
+
+static void store_matrix(double (&out)[4][4], const mat_4& matrix)
+{
+	for (uint32_t r = 0; r < 4; ++r)
+		for (uint32_t c = 0; c < 4; ++c)
+			out[r][c] = matrix.m[r][c];
+}
+
+static mat_4 load_matrix(const double (&matrix)[4][4])
+{
+	mat_4 result;
+	for (uint32_t r = 0; r < 4; ++r)
+		for (uint32_t c = 0; c < 4; ++c)
+			result.m[r][c] = matrix[r][c];
+	return result;
+}
+
+// Screen tile holding a point, row over column in 12 bits each so keys order tiles row by row.
+static uint32_t get_tile_key(const double x, const double y)
+{
+	const auto tile_x = static_cast<uint32_t>(std::min(std::max(x, 0.0) / renderer::tile_size, 4095.0));
+	const auto tile_y = static_cast<uint32_t>(std::min(std::max(y, 0.0) / renderer::tile_size, 4095.0));
+	return tile_y << 12 | tile_x;
+}
+
+static bool is_draw(const command_type type)
+{
+	return type != command_type::clear && type != command_type::clear_depth;
+}
+
+void command_buffer::reset()
+{
+	data_.clear();
+	entries_.clear();
+	states_.clear();
+	state_ = render_state();
+	state_index_ = UINT32_MAX;
+	layer_ = 0;
+}
+
+void command_buffer::set_depth_state(const depth_compare compare, const bool write)
+{
+	state_.compare = compare;
+	state_.depth_write = write;
+	state_index_ = UINT32_MAX;
+}
+
+void command_buffer::set_shading(const shading shade, const blend_mode blend)
+{
+	state_.shade = shade;
+	state_.blend = blend;
+	state_index_ = UINT32_MAX;
+}
+
+void command_buffer::set_cull_mode(const cull_mode cull)
+{
+	state_.cull = cull;
+	state_index_ = UINT32_MAX;
+}
+
+void command_buffer::set_texture(const texture* image, const texture_filter filter)
+{
+	state_.image = image;
+	state_.filter = filter;
+	state_index_ = UINT32_MAX;
+}
+
+void command_buffer::set_line_mode(const line_mode mode)
+{
+	state_.lines = mode;
+	state_index_ = UINT32_MAX;
+}
+
+void command_buffer::set_layer(const uint8_t layer)
+{
+	layer_ = layer;
+}
+
+unsigned char* command_buffer::append(const command_type type, const size_t payload_size, const uint32_t tile)
+{
+	uint64_t key = 0;
+	if (is_draw(type))
+	{
+		// Few distinct states are ever recorded, a linear search finds them.
+		if (state_index_ == UINT32_MAX)
+		{
+			state_index_ = static_cast<uint32_t>(std::find(states_.begin(), states_.end(), state_) - states_.begin());
+			if (state_index_ == states_.size()) states_.push_back(state_);
+		}
+		key = static_cast<uint64_t>(layer_) << 40 | static_cast<uint64_t>(std::min(state_index_, 0xFFFFu)) << 24 | tile;
+	}
+
+	const size_t offset = data_.size();
+	const size_t payload_offset = offset + (sizeof(command_header) + record_alignment - 1) / record_alignment * record_alignment;
+	data_.resize(payload_offset + (payload_size + record_alignment - 1) / record_alignment * record_alignment);
+
+	const command_header header{ type, is_draw(type) ? state_index_ : 0 };
+	std::memcpy(data_.data() + offset, &header, sizeof(header));
+	entries_.push_back({ key, static_cast<uint32_t>(offset) });
+
+	return data_.data() + payload_offset;
+}
+
+void command_buffer::clear_buffer()
+{
+	append(command_type::clear, 0, 0);
+}
+
+void command_buffer::clear_depth(const float depth)
+{
+	std::memcpy(append(command_type::clear_depth, sizeof(float), 0), &depth, sizeof(float));
+}
+
+void command_buffer::draw_pixel(const uint32_t pixel, const uint32_t x, const uint32_t y)
+{
+	const pixel_command command{ pixel, x, y };
+	std::memcpy(append(command_type::pixel, sizeof(command), get_tile_key(x, y)), &command, sizeof(command));
+}
+
+void command_buffer::draw_line(const vec2& start, const vec2& end, const uint32_t color)
+{
+	const line_command command{ { start.x, start.y }, { end.x, end.y }, color };
+	const uint32_t tile = get_tile_key(std::min(start.x, end.x), std::min(start.y, end.y));
+	std::memcpy(append(command_type::line, sizeof(command), tile), &command, sizeof(command));
+}
+
+void command_buffer::draw_lines(const vec2* points, const uint32_t count, const uint32_t color)
+{
+	if (count == 0) return;
+
+	double min_x = points[0].x, min_y = points[0].y;
+	for (uint32_t i = 1; i < count * 2; ++i)
+	{
+		min_x = std::min(min_x, points[i].x);
+		min_y = std::min(min_y, points[i].y);
+	}
+
+	const lines_command command{ count, color };
+	auto* payload = append(command_type::lines, sizeof(command) + count * 4 * sizeof(double), get_tile_key(min_x, min_y));
+	std::memcpy(payload, &command, sizeof(command));
+
+	auto* coordinates = payload + sizeof(command);
+	for (uint32_t i = 0; i < count * 2; ++i)
+	{
+		const double point[2] = { points[i].x, points[i].y };
+		std::memcpy(coordinates + i * sizeof(point), point, sizeof(point));
+	}
+}
+
+void command_buffer::draw_triangles(const vertex* vertices, const uint32_t* indices, const uint32_t count)
+{
+	if (count == 0) return;
+
+	uint32_t vertex_count = 0;
+	for (uint32_t i = 0; i < count * 3; ++i) vertex_count = std::max(vertex_count, indices[i] + 1);
+
+	double min_x = vertices[0].x, min_y = vertices[0].y;
+	for (uint32_t i = 1; i < vertex_count; ++i)
+	{
+		min_x = std::min(min_x, vertices[i].x);
+		min_y = std::min(min_y, vertices[i].y);
+	}
+
+	const triangles_command command{ count, vertex_count };
+	const size_t vertex_bytes = vertex_count * sizeof(vertex);
+	auto* payload = append(command_type::triangles, sizeof(command) + vertex_bytes + count * 3 * sizeof(uint32_t),
+	                       get_tile_key(min_x, min_y));
+	std::memcpy(payload, &command, sizeof(command));
+	std::memcpy(payload + sizeof(command), vertices, vertex_bytes);
+	std::memcpy(payload + sizeof(command) + vertex_bytes, indices, count * 3 * sizeof(uint32_t));
+}
+
+void command_buffer::draw_object(const base_object& object, const mat_4& view_projection)
+{
+	object_command command;
+	command.object = &object;
+	store_matrix(command.matrix, view_projection);
+	std::memcpy(append(command_type::object, sizeof(command), 0), &command, sizeof(command));
+}
+
+void command_buffer::draw_mesh(const mesh_view& mesh, const mat_4& model_view_projection)
+{
+	mesh_command command;
+	command.vertices = mesh.vertices;
+	command.indices = mesh.indices;
+	command.vertex_count = mesh.vertex_count;
+	command.index_count = mesh.index_count;
+	command.center[0] = mesh.bounds.center.x;
+	command.center[1] = mesh.bounds.center.y;
+	command.center[2] = mesh.bounds.center.z;
+	command.radius = mesh.bounds.radius;
+	store_matrix(command.matrix, model_view_projection);
+	std::memcpy(append(command_type::mesh, sizeof(command), 0), &command, sizeof(command));
+}
+
+void command_buffer::sort()
+{
+	const auto by_key = [](const entry& lhs, const entry& rhs) { return lhs.key < rhs.key; };
+
+	// Clears end one run of draws and start the next.
+	auto first = entries_.begin();
+	for (auto it = entries_.begin(); it != entries_.end(); ++it)
+	{
+		if (is_draw(read<command_header>(data_.data() + it->offset).type)) continue;
+
+		std::stable_sort(first, it, by_key);
+		first = it + 1;
+	}
+	std::stable_sort(first, entries_.end(), by_key);
+}
+
+void command_buffer::execute(renderer& target) const
+{
+	const auto saved = target.get_render_state();
+	uint32_t applied = UINT32_MAX;
+
+	for (const auto& e : entries_)
+	{
+		const unsigned char* record = data_.data() + e.offset;
+		const auto header = read<command_header>(record);
+		const unsigned char* payload =
+			record + (sizeof(command_header) + record_alignment - 1) / record_alignment * record_alignment;
+
+		if (is_draw(header.type) && header.state != applied)
+		{
+			target.set_render_state(states_[header.state]);
+			applied = header.state;
+		}
+
+		switch (header.type)
+		{
+		case command_type::clear:
+			target.clear_buffer();
+			break;
+		case command_type::clear_depth:
+			target.clear_depth(read<float>(payload));
+			break;
+		case command_type::pixel:
+		{
+			const auto command = read<pixel_command>(payload);
+			target.draw_pixel(command.pixel, command.x, command.y);
+			break;
+		}
+		case command_type::line:
+		{
+			const auto command = read<line_command>(payload);
+			target.draw_line(vec2(command.start[0], command.start[1]), vec2(command.end[0], command.end[1]), command.color);
+			break;
+		}
+		case command_type::lines:
+		{
+			// The renderer takes vec2 points, they are rebuilt in the frame arena.
+			const auto command = read<lines_command>(payload);
+			const auto* coordinates = payload + sizeof(command);
+			vec2* points = target.get_frame_arena().allocate<vec2>(command.count * 2);
+			for (uint32_t i = 0; i < command.count * 2; ++i)
+			{
+				double point[2];
+				std::memcpy(point, coordinates + i * sizeof(point), sizeof(point));
+				new(points + i) vec2(point[0], point[1]);
+			}
+			target.draw_lines(points, command.count, command.color);
+			break;
+		}
+		case command_type::triangles:
+		{
+			const auto command = read<triangles_command>(payload);
+			const auto* vertices = reinterpret_cast<const vertex*>(payload + sizeof(command));
+			const auto* indices = reinterpret_cast<const uint32_t*>(payload + sizeof(command) +
+				command.vertex_count * sizeof(vertex));
+			target.draw_triangles(vertices, indices, command.count);
+			break;
+		}
+		case command_type::object:
+		{
+			const auto command = read<object_command>(payload);
+			target.draw_object(*command.object, load_matrix(command.matrix));
+			break;
+		}
+		case command_type::mesh:
+		{
+			const auto command = read<mesh_command>(payload);
+			mesh_view mesh;
+			mesh.vertices = command.vertices;
+			mesh.vertex_count = command.vertex_count;
+			mesh.indices = command.indices;
+			mesh.index_count = command.index_count;
+			mesh.bounds.center = vec3(command.center[0], command.center[1], command.center[2]);
+			mesh.bounds.radius = command.radius;
+			target.draw_mesh(mesh, load_matrix(command.matrix));
+			break;
+		}
+		}
+	}
+
+	target.set_render_state(saved);
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "renderer.h"
+
+class base_object;
+struct mat_4;
+struct mesh_view;
+struct vec2;
+struct vertex;
+
+enum class command_type : uint8_t
+{
+	clear,
+	clear_depth,
+	pixel,
+	line,
+	lines,
+	triangles,
+	object,
+	mesh
+};
+
+// Renderer calls recorded into one linear block to run later, with execute. Every draw keeps the state it was
+// recorded with, so recording needs no renderer and can happen on any thread, and a buffer of unchanging
+// content can be executed frame after frame. Points, vertices and indices are copied in, objects, meshes and
+// textures are referenced and have to outlive the buffer.
+class command_buffer
+{
+public:
+	// Drops every command and the recording state, keeps the memory.
+	void reset();
+
+	// State of the draws recorded after it, the renderer defaults until set.
+	void set_depth_state(depth_compare compare, bool write);
+
+	void set_shading(shading shade, blend_mode blend = blend_mode::alpha);
+
+	void set_cull_mode(cull_mode cull);
+
+	void set_texture(const texture* image, texture_filter filter = texture_filter::bilinear);
+
+	void set_line_mode(line_mode mode);
+
+	// Sort layer of the draws recorded after it, zero until set. Lower layers run first once sorted.
+	void set_layer(uint8_t layer);
+
+	void clear_buffer();
+
+	void clear_depth(float depth = 1.0f);
+
+	void draw_pixel(uint32_t pixel, uint32_t x, uint32_t y);
+
+	void draw_line(const vec2& start, const vec2& end, uint32_t color = 0xFFFFFFFF);
+
+	void draw_lines(const vec2* points, uint32_t count, uint32_t color = 0xFFFFFFFF);
+
+	// Copies the vertices up to the highest index used along with the indices.
+	void draw_triangles(const vertex* vertices, const uint32_t* indices, uint32_t count);
+
+	void draw_object(const base_object& object, const mat_4& view_projection);
+
+	void draw_mesh(const mesh_view& mesh, const mat_4& model_view_projection);
+
+	// Orders the draws between two clears by layer, then state, then the screen tile they start in, so state
+	// changes are rare and consecutive draws touch neighbouring tiles. Draws with equal keys keep their order.
+	// Only sort when the order within a layer does not matter, such as for opaque depth tested draws.
+	void sort();
+
+	// Runs every command on target, in recorded order unless sorted. The renderer's state is restored after.
+	void execute(renderer& target) const;
+
+	uint32_t get_command_count() const { return static_cast<uint32_t>(entries_.size()); }
+
+	// Bytes of the encoded commands.
+	size_t get_size() const { return data_.size(); }
+
+	// Distinct states the draws were recorded with.
+	uint32_t get_state_count() const { return static_cast<uint32_t>(states_.size()); }
+
+private:
+	// Commands run in entry order, sort reorders the entries and leaves the encoding alone.
+	struct entry
+	{
+		uint64_t key;
+		uint32_t offset;
+	};
+
+	// Appends a command with room for payload_size bytes after its header and returns that room.
+	unsigned char* append(command_type type, size_t payload_size, uint32_t tile);
+
+	std::vector<unsigned char> data_;
+	std::vector<entry> entries_;
+	std::vector<render_state> states_;
+
+	render_state state_;
+	uint32_t state_index_ = UINT32_MAX;
+	uint8_t layer_ = 0;
+};
@@ -0,0 +1,47 @@
+#include "cpu_features.h"
+
+#if defined(LAB2_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static cpu_features detect()
+{
+	cpu_features features;
+
+#if defined(LAB2_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	const int max_leaf = info[0];
+
+	__cpuid(info, 1);
+	features.sse2 = (info[3] & (1 << 26)) != 0;
+	features.sse41 = (info[2] & (1 << 19)) != 0;
+
+	// Avx registers are only usable when the os saves them on context switches.
+	const bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+	features.avx = os_saves_ymm && (info[2] & (1 << 28)) != 0;
+	features.fma = features.avx && (info[2] & (1 << 12)) != 0;
+
+	if (max_leaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		features.avx2 = features.avx && (info[1] & (1 << 5)) != 0;
+	}
+#elif defined(LAB2_X86)
+	__builtin_cpu_init();
+	features.sse2 = __builtin_cpu_supports("sse2");
+	features.sse41 = __builtin_cpu_supports("sse4.1");
+	features.avx = __builtin_cpu_supports("avx");
+	features.avx2 = __builtin_cpu_supports("avx2");
+	features.fma = __builtin_cpu_supports("fma");
+#endif
+
+	return features;
+}
+
+const cpu_features& cpu_features::get()
+{
+	static const cpu_features features = detect();
+	return features;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LAB2_X86 1
+#endif
+
+// SSE2 is part of every 64 bit x86 target, so it needs no runtime check.
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define LAB2_SSE2 1
+#endif
+
+// MSVC emits any intrinsic anywhere, gcc and clang need the instruction set enabled per function.
+#if defined(LAB2_X86) && (defined(__GNUC__) || defined(__clang__))
+#define LAB2_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define LAB2_TARGET_AVX2_NO_FMA __attribute__((target("avx2")))
+#else
+#define LAB2_TARGET_AVX2
+#define LAB2_TARGET_AVX2_NO_FMA
+#endif
+
+// Instruction sets the running cpu and os support, read once through cpuid.
+struct cpu_features
+{
+	bool sse2 = false;
+	bool sse41 = false;
+	bool avx = false;
+	bool avx2 = false;
+	bool fma = false;
+
+	static const cpu_features& get();
+};
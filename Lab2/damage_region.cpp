@@ -0,0 +1,99 @@
+#include "damage_region.h"
+
+#include <algorithm>
+
+static bool is_empty(const screen_rect& rect)
+{
+	return rect.min_x >= rect.max_x || rect.min_y >= rect.max_y;
+}
+
+static bool intersects(const screen_rect& a, const screen_rect& b)
+{
+	return a.min_x < b.max_x && b.min_x < a.max_x && a.min_y < b.max_y && b.min_y < a.max_y;
+}
+
+static screen_rect get_union(const screen_rect& a, const screen_rect& b)
+{
+	return {
+		std::min(a.min_x, b.min_x), std::min(a.min_y, b.min_y), std::max(a.max_x, b.max_x),
+		std::max(a.max_y, b.max_y)
+	};
+}
+
+static uint64_t rect_area(const screen_rect& rect)
+{
+	return static_cast<uint64_t>(rect.max_x - rect.min_x) * static_cast<uint64_t>(rect.max_y - rect.min_y);
+}
+
+void damage_region::add(const screen_rect& rect)
+{
+	if (is_empty(rect)) return;
+
+	// Absorb every rectangle the new one touches, the bounds can then reach further ones.
+	auto merged = rect;
+	for (uint32_t i = 0; i < count_;)
+	{
+		if (intersects(rects_[i], merged))
+		{
+			merged = get_union(merged, rects_[i]);
+			rects_[i] = rects_[--count_];
+			i = 0;
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	if (count_ < max_rects)
+	{
+		rects_[count_++] = merged;
+		return;
+	}
+
+	// Full, merge with the rectangle whose bounds grow the least and restore disjointness.
+	uint32_t best = 0;
+	uint64_t best_growth = UINT64_MAX;
+	for (uint32_t i = 0; i < count_; ++i)
+	{
+		const auto growth = rect_area(get_union(rects_[i], merged)) - rect_area(rects_[i]);
+		if (growth < best_growth)
+		{
+			best = i;
+			best_growth = growth;
+		}
+	}
+
+	merged = get_union(merged, rects_[best]);
+	rects_[best] = rects_[--count_];
+	add(merged);
+}
+
+void damage_region::add(const damage_region& other)
+{
+	for (const auto& rect : other) add(rect);
+}
+
+uint64_t damage_region::get_area() const
+{
+	uint64_t area = 0;
+	for (const auto& rect : *this) area += rect_area(rect);
+	return area;
+}
+
+void damage_region::align(const uint32_t grid, const uint32_t width, const uint32_t height)
+{
+	const auto step = static_cast<int32_t>(grid);
+	damage_region aligned;
+
+	for (const auto& rect : *this)
+	{
+		aligned.add({
+			rect.min_x / step * step, rect.min_y / step * step,
+			std::min((rect.max_x + step - 1) / step * step, static_cast<int32_t>(width)),
+			std::min((rect.max_y + step - 1) / step * step, static_cast<int32_t>(height))
+		});
+	}
+
+	*this = aligned;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+#include "rasterizer.h"
+
+// Screen area that changed, as a few disjoint rectangles. Overlapping rectangles are merged into their
+// bounds, and once max_rects are in use new ones merge with whichever grows the least, so the region
+// may cover more than was added but never less.
+class damage_region
+{
+public:
+	static constexpr uint32_t max_rects = 8;
+
+	void add(const screen_rect& rect);
+
+	void add(const damage_region& other);
+
+	void clear() { count_ = 0; }
+
+	bool empty() const { return count_ == 0; }
+
+	uint32_t size() const { return count_; }
+
+	const screen_rect* begin() const { return rects_; }
+
+	const screen_rect* end() const { return rects_ + count_; }
+
+	uint64_t get_area() const;
+
+	// Grows every rectangle outwards to multiples of grid, clamped to width and height.
+	void align(uint32_t grid, uint32_t width, uint32_t height);
+
+private:
+	screen_rect rects_[max_rects] = {};
+	uint32_t count_ = 0;
+};
@@ -0,0 +1,69 @@
+#include "depth_buffer.h"
+
+#include <algorithm>
+
+depth_buffer::depth_buffer(const uint32_t width, const uint32_t height, const uint32_t tile_size): width(width),
+	height(height),
+	tile_size_(tile_size),
+	tiles_x_((width + tile_size - 1) / tile_size),
+	tiles_y_((height + tile_size - 1) / tile_size),
+	depths_(new float[static_cast<size_t>(width) * height]),
+	tile_min_(get_tile_count()),
+	tile_max_(get_tile_count())
+{
+	clear(1.0f);
+}
+
+void depth_buffer::clear(const float depth)
+{
+	std::fill_n(depths_.get(), static_cast<size_t>(width) * height, depth);
+	std::fill(tile_min_.begin(), tile_min_.end(), depth);
+	std::fill(tile_max_.begin(), tile_max_.end(), depth);
+}
+
+bool depth_buffer::rejects(const uint32_t tile, const depth_compare compare, const float min_z, const float max_z) const
+{
+	switch (compare)
+	{
+	case depth_compare::never: return true;
+	case depth_compare::less: return min_z >= tile_max_[tile];
+	case depth_compare::less_equal: return min_z > tile_max_[tile];
+	case depth_compare::equal: return max_z < tile_min_[tile] || min_z > tile_max_[tile];
+	case depth_compare::greater_equal: return max_z < tile_min_[tile];
+	case depth_compare::greater: return max_z <= tile_min_[tile];
+	default: return false;
+	}
+}
+
+void depth_buffer::note_write(const uint32_t tile, const depth_compare compare, const float min_z, const float max_z)
+{
+	// A passing less write only lowers depths, so the tile maximum still holds, and the same for greater.
+	const bool lowers = compare == depth_compare::less || compare == depth_compare::less_equal;
+	const bool raises = compare == depth_compare::greater || compare == depth_compare::greater_equal;
+
+	if (!raises) tile_min_[tile] = std::min(tile_min_[tile], min_z);
+	if (!lowers) tile_max_[tile] = std::max(tile_max_[tile], max_z);
+}
+
+void depth_buffer::refresh_tile(const uint32_t tile)
+{
+	const auto min_x = tile % tiles_x_ * tile_size_;
+	const auto min_y = tile / tiles_x_ * tile_size_;
+	const auto max_x = std::min(min_x + tile_size_, width);
+	const auto max_y = std::min(min_y + tile_size_, height);
+
+	float low = depths_[static_cast<size_t>(min_y) * width + min_x];
+	float high = low;
+	for (auto y = min_y; y < max_y; ++y)
+	{
+		const float* row = depths_.get() + static_cast<size_t>(y) * width;
+		for (auto x = min_x; x < max_x; ++x)
+		{
+			low = std::min(low, row[x]);
+			high = std::max(high, row[x]);
+		}
+	}
+
+	tile_min_[tile] = low;
+	tile_max_[tile] = high;
+}
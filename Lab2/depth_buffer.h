@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Test an incoming depth against the stored one, the pixel is drawn when it passes.
+enum class depth_compare
+{
+	never,
+	less,
+	less_equal,
+	equal,
+	greater_equal,
+	greater,
+	not_equal,
+	always
+};
+
+// 32 bit float depth per pixel plus a hierarchical-Z level holding conservative min/max depth per screen tile.
+// The tile bounds only ever widen with writes unless refreshed, so a rejection they report is always exact.
+class depth_buffer
+{
+public:
+	depth_buffer(uint32_t width, uint32_t height, uint32_t tile_size);
+
+	depth_buffer(const depth_buffer& other) = delete;
+
+	depth_buffer& operator=(const depth_buffer& other) = delete;
+
+	const uint32_t width;
+	const uint32_t height;
+
+	void clear(float depth);
+
+	float* get_data() const { return depths_.get(); }
+
+	float get_depth(const uint32_t x, const uint32_t y) const { return depths_[static_cast<size_t>(y) * width + x]; }
+
+	static bool passes(const depth_compare compare, const float incoming, const float stored)
+	{
+		switch (compare)
+		{
+		case depth_compare::never: return false;
+		case depth_compare::less: return incoming < stored;
+		case depth_compare::less_equal: return incoming <= stored;
+		case depth_compare::equal: return incoming == stored;
+		case depth_compare::greater_equal: return incoming >= stored;
+		case depth_compare::greater: return incoming > stored;
+		case depth_compare::not_equal: return incoming != stored;
+		default: return true;
+		}
+	}
+
+	uint32_t get_tile_count() const { return tiles_x_ * tiles_y_; }
+
+	float get_tile_min(const uint32_t tile) const { return tile_min_[tile]; }
+
+	float get_tile_max(const uint32_t tile) const { return tile_max_[tile]; }
+
+	// True when no depth in [min_z, max_z] can pass the compare anywhere in the tile.
+	bool rejects(uint32_t tile, depth_compare compare, float min_z, float max_z) const;
+
+	// Widens the tile bounds after depths in [min_z, max_z] were written under compare.
+	void note_write(uint32_t tile, depth_compare compare, float min_z, float max_z);
+
+	// Recomputes the exact tile bounds, worth it after a write may have covered the whole tile.
+	void refresh_tile(uint32_t tile);
+
+private:
+	const uint32_t tile_size_;
+	const uint32_t tiles_x_;
+	const uint32_t tiles_y_;
+
+	std::unique_ptr<float[]> depths_;
+	std::vector<float> tile_min_;
+	std::vector<float> tile_max_;
+};
@@ -1,57 +1,110 @@
 #include "engine.h"
 
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
 #include "engine_data.h"
+#include "profiler.h"
 #include "RasterSurface.h"
 #include "renderer.h"
 
-engine::engine(uint32_t width, uint32_t height): render_manager_(new renderer(width, height, color::cornflower_blue))
+engine::engine(uint32_t width, uint32_t height, uint32_t worker_count, const frame_schedule_options& schedule):
+	render_manager_(new renderer(width, height, color::cornflower_blue)),
+	scheduler_(schedule)
 {
+	render_manager_->set_worker_count(worker_count);
+
+	// Only the line changes from frame to frame.
+	render_manager_->set_incremental(true);
 }
 
+engine::~engine() = default;
+
 void engine::start()
 {
 	RS_Initialize("Dustin Roden", render_manager_->width, render_manager_->height);
 
-	mat_4 a = mat_4::identity();
-	mat_4 b = mat_4::roll(2 * PI);
-	mat_4 c = a * b;
-	// Used to signal worker threads to exit safely.
-	signal_future_ = exit_signal_.get_future();
-
-	// detach worker threads.
-	std::thread{ [this]()
+	std::thread render_thread{ [this]()
 	{
-		do
+		profiler::set_thread_name("render");
+
+		// The scheduler paces every frame and wakes this thread straight away on shutdown.
+		while (scheduler_.begin_frame())
 		{
 			render();
 			update();
+			scheduler_.frame_published(render_manager_->get_published_count());
+		}
+	} };
 
-		} while (signal_future_.wait_for(std::chrono::milliseconds(1)) == std::future_status::timeout);
-
-	} }.detach();
+	profiler::set_thread_name("present");
 
-	// join the update thread.
-	std::thread{ [this]()
+	// Present until the window is shut down.
+	for (;;)
 	{
-		// Update until the window is shut down.
-		while (RS_Update(render_manager_->get_frame(), render_manager_->get_screen_size())) {}
+		const auto frame = render_manager_->get_frame();
+
+		LAB2_PROFILE_ZONE("present");
+
+		// Only the rectangles that changed since the last presented frame are handed over.
+		uint32_t rects[damage_region::max_rects * 4];
+		uint32_t rect_count = 0;
+		for (const auto& rect : render_manager_->get_frame_damage())
+		{
+			rects[rect_count * 4] = static_cast<uint32_t>(rect.min_x);
+			rects[rect_count * 4 + 1] = static_cast<uint32_t>(rect.min_y);
+			rects[rect_count * 4 + 2] = static_cast<uint32_t>(rect.max_x);
+			rects[rect_count * 4 + 3] = static_cast<uint32_t>(rect.max_y);
+			++rect_count;
+		}
+
+		if (!RS_UpdateRegion(frame, render_manager_->get_screen_size(), rects, rect_count)) break;
 
-	} }.join();
+		scheduler_.frame_presented(render_manager_->get_frame_sequence());
+		profiler::mark_frame();
+	}
 
-	// Inform the engine to shut down.
-	exit_signal_.set_value();
+	scheduler_.stop();
+	render_thread.join();
 
 	RS_Shutdown();
 }
 
 void engine::update() const
 {
+	LAB2_PROFILE_ZONE("engine::update");
+
 	render_manager_->update_frame();
 }
+// Pixels a line between a and b can touch.
+static screen_rect get_line_bounds(const vec2 a, const vec2 b)
+{
+	return {
+		static_cast<int32_t>(std::floor(std::min(a.x, b.x))) - 1,
+		static_cast<int32_t>(std::floor(std::min(a.y, b.y))) - 1,
+		static_cast<int32_t>(std::ceil(std::max(a.x, b.x))) + 2,
+		static_cast<int32_t>(std::ceil(std::max(a.y, b.y))) + 2
+	};
+}
+
 vec2 end { 0,0};
 void engine::render() const
 {
-	render_manager_->clear_buffer();
+	LAB2_PROFILE_ZONE("engine::render");
+
+	const vec2 start{ 100, 100 };
+	const vec2 previous = end;
+	end += 1;
+
+	// Where the line was and where it is now.
+	render_manager_->invalidate(get_line_bounds(start, previous));
+	render_manager_->invalidate(get_line_bounds(start, end));
+	render_manager_->begin_frame();
 
-	render_manager_->draw_line({ 100, 100 }, end += 1, color::green);
+	commands_.reset();
+	commands_.set_line_mode(line_mode::smooth);
+	commands_.clear_buffer();
+	commands_.draw_line(start, end, color::green);
+	commands_.execute(*render_manager_);
 }
@@ -1,13 +1,27 @@
 #pragma once
-#include <future>
+#include <cstdint>
+#include <memory>
+
+#include "command_buffer.h"
+#include "frame_scheduler.h"
 class renderer;
 struct vec2;
 
 class engine
 {
 public:
-	explicit engine(uint32_t width = 500, uint32_t height = 500);
+	// worker_count is the number of threads the renderer rasterizes on, zero uses every core.
+	explicit engine(uint32_t width = 500, uint32_t height = 500, uint32_t worker_count = 0,
+	                const frame_schedule_options& schedule = {});
+
+	// Defined where renderer is complete.
+	~engine();
+
+	engine(const engine& other) = delete;
 
+	engine& operator=(const engine& other) = delete;
+
+	// Renders on a second thread and presents on the calling one, returns once the surface is closed.
 	void start();
 
 	void update() const;
@@ -15,7 +29,9 @@ public:
 	void render() const;
 
 protected:
-	const renderer* render_manager_;
-	std::promise<void> exit_signal_;
-	std::future<void> signal_future_;
+	std::unique_ptr<renderer> render_manager_;
+	frame_scheduler scheduler_;
+
+	// Frame content is recorded here by render and then executed.
+	mutable command_buffer commands_;
 };
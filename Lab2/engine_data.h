@@ -1,14 +1,13 @@
 #pragma once
 
+#define _USE_MATH_DEFINES
 #include <cmath>
-#include <corecrt_math_defines.h>
 #include <cstdint>
 #include <limits>
 #include <stdexcept>
 
-// Credit of Weather Vane, for use in math_helper::sqrt() https://stackoverflow.com/questions/29018864/any-way-to-obtain-square-root-of-a-number-without-using-math-h-and-sqrt
-//#define MINDIFF 2.2250738585072014e-308   // smallest positive double
-#define MINDIFF 2.25e-308                   // use for convergence check
+#include "math_kernels.h"
+
 #define DEPSILON std::numeric_limits<double>::epsilon()
 #define PI M_PI
 
@@ -108,8 +107,8 @@ struct vec2
 
 	friend bool operator==(const vec2& lhs, const vec2& rhs)
 	{
-		return lhs.x - rhs.x <= MINDIFF
-			&& lhs.y - rhs.y <= MINDIFF;
+		return lhs.x - rhs.x <= DEPSILON
+			&& lhs.y - rhs.y <= DEPSILON;
 	}
 
 	friend bool operator!=(const vec2& lhs, const vec2& rhs)
@@ -229,48 +228,55 @@ struct color
 	static constexpr unsigned int purple = 0xFFFF00FF;
 	static constexpr unsigned int cyan = 0XFF00FFFF;
 
-	color() : a(0), r(0), g(0), b(0)
+	color() : argb(0)
 	{
 	}
 
-	explicit color(const unsigned char v) : a(v), r(v), g(v), b(v)
+	// Packed 0xAARRGGBB, the way pixels are stored.
+	explicit color(const uint32_t argb) : argb(argb)
 	{
 	}
 
-	explicit color(const char r, const char g, const char b)
-		: a(0xFF),
-		r(r),
-		g(g),
-		b(b)
+	explicit color(const uint8_t r, const uint8_t g, const uint8_t b)
+		: argb(0xFF000000u | static_cast<uint32_t>(r) << 16 | static_cast<uint32_t>(g) << 8 | b)
 	{
 	}
 
-	explicit color(const char a, const char r, const char g, const char b)
-		: a(a),
-		r(r),
-		g(g),
-		b(b)
+	explicit color(const uint8_t a, const uint8_t r, const uint8_t g, const uint8_t b)
+		: argb(static_cast<uint32_t>(a) << 24 | static_cast<uint32_t>(r) << 16 | static_cast<uint32_t>(g) << 8 | b)
 	{
 	}
 
-	unsigned char a;
-	unsigned char r;
-	unsigned char g;
-	unsigned char b;
+	uint8_t a() const { return static_cast<uint8_t>(argb >> 24); }
+
+	uint8_t r() const { return static_cast<uint8_t>(argb >> 16); }
+
+	uint8_t g() const { return static_cast<uint8_t>(argb >> 8); }
+
+	uint8_t b() const { return static_cast<uint8_t>(argb); }
 
 	uint32_t convert() const
 	{
-		return a << 24 | r << 16 | g << 8 | b;
+		return argb;
 	}
+
+	uint32_t argb;
+};
+
+// Object space bounds used to cull whole objects.
+struct bounding_sphere
+{
+	vec3 center;
+	double radius = 0;
 };
 
 struct vertex
 {
-	vertex() : x(0), y(0), z(0), w(1), color(0)
+	vertex() : x(0), y(0), z(0), w(1), color(), u(0), v(0)
 	{
 	}
 
-	explicit vertex(const vec3 v, const color color) : x(v.x), y(v.y), z(v.z), w(1), color(color)
+	explicit vertex(const vec3 v, const color color) : x(v.x), y(v.y), z(v.z), w(1), color(color), u(0), v(0)
 	{
 	}
 
@@ -279,16 +285,45 @@ struct vertex
 		y(y),
 		z(z),
 		w(w),
-		color(color)
+		color(color),
+		u(0),
+		v(0)
+	{
+	}
+
+	explicit vertex(const double x, const double y, const double z, const double w, const color color, const double u,
+	                const double v)
+		: x(x),
+		y(y),
+		z(z),
+		w(w),
+		color(color),
+		u(u),
+		v(v)
 	{
 	}
 
 	double x;
 	double y;
 	double z;
+	// Clip space w the position was divided by, attributes are interpolated perspective correct with it.
 	double w;
 
-	color color;
+	::color color;
+
+	// Texture coordinates.
+	double u;
+	double v;
+};
+
+// Indexed geometry owned elsewhere, by a base_object or a mapped mesh file.
+struct mesh_view
+{
+	const vertex* vertices = nullptr;
+	uint32_t vertex_count = 0;
+	const uint32_t* indices = nullptr;
+	uint32_t index_count = 0;
+	bounding_sphere bounds;
 };
 
 struct vec4
@@ -344,6 +379,11 @@ struct vec4
 		}
 	}
 
+	double operator[](const uint32_t index) const
+	{
+		return const_cast<vec4&>(*this)[index];
+	}
+
 	vec4(const vec4& other) = default;
 
 	vec4(vec4&& other) noexcept
@@ -558,7 +598,7 @@ struct mat_4
 
 	mat_4& scale(const double size)
 	{
-		this = *this * (identity()*size);
+		*this = *this * (identity()*size);
 
 		return *this;
 	}
@@ -568,13 +608,13 @@ struct mat_4
 		return { m[0] * other, m[1] * other, m[2] * other, m[3] * other };
 	}
 
-	mat_4 operator*(mat_4& other)
+	mat_4 operator*(const mat_4& other) const
 	{
 		mat_4 ret{};
 
-		for (int i = 0; i < 3; ++i)
-			for (int j = 0; j < 3; ++j)
-				for (int k = 0; k < 3; ++k) {
+		for (int i = 0; i < 4; ++i)
+			for (int k = 0; k < 4; ++k)
+				for (int j = 0; j < 4; ++j) {
 					ret.m[i][j] += m[i][k] * other.m[k][j];
 				}
 
@@ -583,40 +623,14 @@ struct mat_4
 
 	mat_4& operator*=(mat_4& other)
 	{
-		for (auto& i : m)
-		{
-			for (int j = 0; j < 4; ++j)
-			{
-				i[j] = 0;
-
-				for (int k = 0; k < 4; ++k)
-				{
-					i[j] += i[k] * other.m[k][j];
-				}
-			}
-		}
+		*this = *this * other;
 
 		return *this;
 	}
 
 	mat_4 operator*=(mat_4& other) const
 	{
-		mat_4 ret{};
-
-		for (auto& i : ret.m)
-		{
-			for (int j = 0; j < 4; ++j)
-			{
-				i[j] = 0;
-
-				for (int k = 0; k < 4; ++k)
-				{
-					i[j] += i[k] * other.m[k][j];
-				}
-			}
-		}
-
-		return ret;
+		return *this * other;
 	}
 
 	friend bool operator==(const mat_4& lhs, const mat_4& rhs)
@@ -680,32 +694,62 @@ struct mat_4
 		};
 	}
 
+	static mat_4 translation(const double x, const double y, const double z)
+	{
+		return {
+			{1, 0, 0, x},
+			{0, 1, 0, y},
+			{0, 0, 1, z},
+			{0, 0, 0, 1}
+		};
+	}
+
+	// Right handed view space looking down -z into clip space with 0 <= z <= w, near maps to depth 0 and far to 1.
+	static mat_4 perspective(const double fov_y, const double aspect, const double near_plane, const double far_plane)
+	{
+		const double f = 1.0 / std::tan(fov_y / 2);
+		const double range = far_plane / (near_plane - far_plane);
+
+		return {
+			{f / aspect, 0, 0, 0},
+			{0, f, 0, 0},
+			{0, 0, range, near_plane * range},
+			{0, 0, -1, 0}
+		};
+	}
+
 	static mat_4 roll(const double angle)
 	{
+		double s, c;
+		math_kernels::sincos(angle, s, c);
 		return {
 			{1, 0, 0, 0},
-			{0, std::cos(angle), - std::sin(angle), 0},
-			{0, std::sin(angle), std::cos(angle), 0},
+			{0, c, -s, 0},
+			{0, s, c, 0},
 			{0, 0, 0, 1}
 		};
 	}
 
 	static mat_4 pitch(const double angle)
 	{
+		double s, c;
+		math_kernels::sincos(angle, s, c);
 		return {
-			{std::cos(angle), 0, std::sin(angle), 0},
+			{c, 0, s, 0},
 			{0, 1, 0, 0},
-			{-std::sin(angle), 0, std::cos(angle), 0},
+			{-s, 0, c, 0},
 			{0, 0, 0, 1}
 		};
 	}
 
 	static mat_4 yaw(const double angle)
 	{
+		double s, c;
+		math_kernels::sincos(angle, s, c);
 		return {
-			{std::cos(angle), -std::sin(angle), 0, 0},
-			{std::sin(angle), std::cos(angle), 0, 0},
-			{0, 0, 0, 0},
+			{c, -s, 0, 0},
+			{s, c, 0, 0},
+			{0, 0, 1, 0},
 			{0, 0, 0, 1}
 		};
 	}
@@ -0,0 +1,64 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+
+frame_arena::frame_arena(const size_t chunk_size) : chunk_size_(chunk_size)
+{
+}
+
+void* frame_arena::allocate(const size_t bytes, const size_t alignment)
+{
+	++stats_.allocations;
+
+	for (;;)
+	{
+		if (current_ < chunks_.size())
+		{
+			// Aligns the address, chunks themselves are only aligned for fundamental types.
+			const auto base = reinterpret_cast<uintptr_t>(chunks_[current_].data.get());
+			const auto start = (base + offset_ + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+			const auto end = start - base + bytes;
+
+			if (end <= chunks_[current_].size)
+			{
+				stats_.bytes += end - offset_;
+				offset_ = end;
+				return reinterpret_cast<void*>(start);
+			}
+
+			// The rest of this chunk is wasted until the next reset.
+			stats_.bytes += chunks_[current_].size - offset_;
+			++current_;
+			offset_ = 0;
+			continue;
+		}
+
+		add_chunk(std::max(chunk_size_, bytes + alignment));
+	}
+}
+
+void frame_arena::reset()
+{
+	stats_.peak_bytes = std::max(stats_.peak_bytes, stats_.bytes);
+
+	if (chunks_.size() > 1 && current_ > 0)
+	{
+		const auto capacity = stats_.capacity;
+		chunks_.clear();
+		stats_.capacity = 0;
+		add_chunk(static_cast<size_t>(capacity));
+	}
+
+	current_ = 0;
+	offset_ = 0;
+	stats_.allocations = 0;
+	stats_.bytes = 0;
+	++stats_.resets;
+}
+
+void frame_arena::add_chunk(const size_t size)
+{
+	chunks_.push_back({ std::unique_ptr<unsigned char[]>(new unsigned char[size]), size });
+	stats_.capacity += size;
+	++stats_.heap_allocations;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+struct arena_stats
+{
+	// Since the last reset.
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+
+	// Most bytes any frame used, and the bytes the arena holds.
+	uint64_t peak_bytes = 0;
+	uint64_t capacity = 0;
+
+	// Chunks taken from the heap since construction, flat once the frame size settles.
+	uint64_t heap_allocations = 0;
+	uint64_t resets = 0;
+};
+
+// Linear allocator for data that lives until the end of the frame. Allocating bumps an offset, nothing is
+// freed on its own, reset releases everything at once. Not thread safe, allocate on one thread only.
+class frame_arena
+{
+public:
+	explicit frame_arena(size_t chunk_size = 1 << 20);
+
+	frame_arena(const frame_arena& other) = delete;
+
+	frame_arena& operator=(const frame_arena& other) = delete;
+
+	// Alignment has to be a power of two.
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+	// Uninitialized room for count objects, destructors never run so only trivial types are allowed.
+	template <typename T>
+	T* allocate(const size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "arena memory is released without destructors");
+		return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	// Ends the frame, every pointer handed out becomes invalid. A frame that spilled over into extra chunks
+	// gets one chunk big enough for all of it, so a steady frame loop stops touching the heap.
+	void reset();
+
+	const arena_stats& get_stats() const { return stats_; }
+
+private:
+	struct chunk
+	{
+		std::unique_ptr<unsigned char[]> data;
+		size_t size;
+	};
+
+	void add_chunk(size_t size);
+
+	const size_t chunk_size_;
+	std::vector<chunk> chunks_;
+	size_t current_ = 0;
+	size_t offset_ = 0;
+	arena_stats stats_;
+};
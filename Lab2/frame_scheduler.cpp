@@ -0,0 +1,72 @@
+#include "frame_scheduler.h"
+
+#include <algorithm>
+
+#include "profiler.h"
+
+frame_scheduler::frame_scheduler(const frame_schedule_options& options): options_(options),
+	period_(std::chrono::duration_cast<clock::duration>(
+		std::chrono::duration<double>(1.0 / std::max(options.frame_rate, 1.0)))),
+	next_frame_(clock::now())
+{
+}
+
+bool frame_scheduler::begin_frame()
+{
+	LAB2_PROFILE_ZONE("wait_frame");
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (options_.pacing == frame_pacing::uncapped) return !stopped_;
+
+	// Backpressure, the presenter has to catch up before another frame starts.
+	const auto limit = std::max(options_.max_frames_in_flight, 1u);
+	changed_.wait(lock, [&]() { return stopped_ || published_ - presented_ < limit; });
+
+	if (options_.pacing == frame_pacing::fixed_rate && !stopped_)
+	{
+		changed_.wait_until(lock, next_frame_, [&]() { return stopped_; });
+
+		// Fell more than a frame behind, restart the clock instead of bursting to catch up.
+		const auto now = clock::now();
+		next_frame_ = std::max(next_frame_ + period_, now);
+	}
+
+	return !stopped_;
+}
+
+void frame_scheduler::frame_published(const uint64_t sequence)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	published_ = std::max(published_, sequence);
+}
+
+void frame_scheduler::frame_presented(const uint64_t sequence)
+{
+	{
+		// Frames the swap chain replaced are never presented, the newer sequence covers them.
+		std::lock_guard<std::mutex> lock(mutex_);
+		presented_ = std::max(presented_, sequence);
+	}
+	changed_.notify_all();
+}
+
+void frame_scheduler::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopped_ = true;
+	}
+	changed_.notify_all();
+}
+
+bool frame_scheduler::is_stopped() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stopped_;
+}
+
+uint64_t frame_scheduler::get_frames_in_flight() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return published_ - presented_;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+enum class frame_pacing
+{
+	// Render as fast as possible, frames the presenter has not taken yet are replaced.
+	uncapped,
+	// Start frames on a fixed clock, bounded by the frames in flight.
+	fixed_rate,
+	// Start a frame once the presenter has caught up to the frames in flight.
+	presenter_driven
+};
+
+struct frame_schedule_options
+{
+	frame_pacing pacing = frame_pacing::presenter_driven;
+	// Frames per second for fixed_rate.
+	double frame_rate = 60;
+	// Frames published but not yet presented before the render thread waits, at least one.
+	uint32_t max_frames_in_flight = 2;
+};
+
+// Paces the render thread against the presenter. The render thread asks to begin each frame and reports what
+// it published, the presenter reports what it presented. Waits are on a condition variable, so stopping or
+// a presented frame wakes the render thread immediately instead of on the next poll.
+class frame_scheduler
+{
+public:
+	explicit frame_scheduler(const frame_schedule_options& options = {});
+
+	frame_scheduler(const frame_scheduler& other) = delete;
+
+	frame_scheduler& operator=(const frame_scheduler& other) = delete;
+
+	const frame_schedule_options& get_options() const { return options_; }
+
+	// Render thread, waits until the next frame may start. Returns false once stopped.
+	bool begin_frame();
+
+	// Render thread, sequence is the published frame's number from the swap chain.
+	void frame_published(uint64_t sequence);
+
+	// Presenter, sequence is the number of the frame it just presented.
+	void frame_presented(uint64_t sequence);
+
+	// Wakes and releases every waiting thread, begin_frame returns false from now on.
+	void stop();
+
+	bool is_stopped() const;
+
+	uint64_t get_frames_in_flight() const;
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	const frame_schedule_options options_;
+	const clock::duration period_;
+	clock::time_point next_frame_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable changed_;
+	uint64_t published_ = 0;
+	uint64_t presented_ = 0;
+	bool stopped_ = false;
+};
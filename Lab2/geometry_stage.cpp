@@ -0,0 +1,295 @@
+#include "geometry_stage.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "math_core.h"
+
+namespace
+{
+	// A vertex in clip space with its attributes as doubles, so clipping can interpolate them linearly.
+	struct clip_vertex
+	{
+		double position[4];
+		double attributes[6];
+	};
+
+	// Signed distance to plane i in units of w, inside when >= 0.
+	double plane_distance(const clip_vertex& v, const int plane)
+	{
+		const double* p = v.position;
+		switch (plane)
+		{
+		case 0: return p[3] + p[0];
+		case 1: return p[3] - p[0];
+		case 2: return p[3] + p[1];
+		case 3: return p[3] - p[1];
+		case 4: return p[2];
+		default: return p[3] - p[2];
+		}
+	}
+
+	uint32_t outcode(const clip_vertex& v)
+	{
+		uint32_t code = 0;
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			if (plane_distance(v, plane) < 0) code |= 1u << plane;
+		}
+		return code;
+	}
+
+	clip_vertex lerp(const clip_vertex& a, const clip_vertex& b, const double t)
+	{
+		clip_vertex result;
+		for (int i = 0; i < 4; ++i) result.position[i] = a.position[i] + (b.position[i] - a.position[i]) * t;
+		for (int i = 0; i < 6; ++i) result.attributes[i] = a.attributes[i] + (b.attributes[i] - a.attributes[i]) * t;
+		return result;
+	}
+
+	// Clips a convex polygon against one plane, returns the new vertex count.
+	uint32_t clip_polygon(const clip_vertex* in, const uint32_t count, clip_vertex* out, const int plane)
+	{
+		uint32_t written = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const auto& current = in[i];
+			const auto& next = in[(i + 1) % count];
+			const double d0 = plane_distance(current, plane);
+			const double d1 = plane_distance(next, plane);
+
+			if (d0 >= 0) out[written++] = current;
+			if ((d0 >= 0) != (d1 >= 0)) out[written++] = lerp(current, next, d0 / (d0 - d1));
+		}
+		return written;
+	}
+
+	struct cache_entry
+	{
+		uint32_t index;
+		// Position of the screen vertex already written for it, no_index until then.
+		uint32_t screen;
+		uint32_t code;
+		clip_vertex vertex;
+	};
+
+	constexpr uint32_t vertex_cache_size = 64;
+	constexpr uint32_t no_index = 0xFFFFFFFF;
+
+	// Winding from the homogeneous determinant of x, y and w (Olano and Greer). For w > 0 its sign is the sign of
+	// the normalized device area, and it stays right for triangles reaching behind the eye, so faces can be culled
+	// before clipping. Front faces are counter-clockwise in normalized device coordinates.
+	bool is_culled(const clip_vertex* triangle, const cull_mode cull)
+	{
+		const double* a = triangle[0].position;
+		const double* b = triangle[1].position;
+		const double* c = triangle[2].position;
+		const double determinant = a[0] * (b[1] * c[3] - c[1] * b[3]) - a[1] * (b[0] * c[3] - c[0] * b[3]) +
+			a[3] * (b[0] * c[1] - c[0] * b[1]);
+
+		// Edge on triangles cover nothing either way.
+		return cull == cull_mode::back ? determinant <= 0 : determinant >= 0;
+	}
+
+	vertex to_screen(const clip_vertex& v, const double width, const double height)
+	{
+		const double w = v.position[3];
+		const double inv_w = 1.0 / w;
+		const auto channel = [](const double value)
+		{
+			return static_cast<uint8_t>(std::min(std::max(value, 0.0), 255.0) + 0.5);
+		};
+
+		// NDC y points up, screen rows go down.
+		return vertex((v.position[0] * inv_w * 0.5 + 0.5) * width, (0.5 - v.position[1] * inv_w * 0.5) * height,
+		              v.position[2] * inv_w, w,
+		              color(channel(v.attributes[0]), channel(v.attributes[1]), channel(v.attributes[2]),
+		                    channel(v.attributes[3])),
+		              v.attributes[4], v.attributes[5]);
+	}
+}
+
+frustum geometry_stage::get_frustum(const mat_4& model_view_projection)
+{
+	const auto& m = model_view_projection.m;
+	const double signs[6][2] = { { 0, 1 }, { 0, -1 }, { 1, 1 }, { 1, -1 }, { 2, 0 }, { 2, -1 } };
+
+	// Gribb-Hartmann, each clip plane is the w row plus or minus another row (z >= 0 is the z row alone).
+	frustum result;
+	for (int plane = 0; plane < 6; ++plane)
+	{
+		const auto row = static_cast<uint32_t>(signs[plane][0]);
+		const double sign = signs[plane][1];
+		const double w_weight = plane == 4 ? 0.0 : 1.0;
+		const double row_weight = plane == 4 ? 1.0 : sign;
+
+		double length = 0;
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			result.planes[plane][i] = w_weight * m[3][i] + row_weight * m[row][i];
+			if (i < 3) length += result.planes[plane][i] * result.planes[plane][i];
+		}
+
+		length = std::sqrt(length);
+		if (length > 0)
+			for (auto& value : result.planes[plane]) value /= length;
+	}
+	return result;
+}
+
+cull_result geometry_stage::classify(const frustum& planes, const bounding_sphere& bounds)
+{
+	auto result = cull_result::inside;
+	for (const auto& plane : planes.planes)
+	{
+		const double distance = plane[0] * bounds.center.x + plane[1] * bounds.center.y + plane[2] * bounds.center.z +
+			plane[3];
+
+		if (distance < -bounds.radius) return cull_result::outside;
+		if (distance < bounds.radius) result = cull_result::intersecting;
+	}
+	return result;
+}
+
+bounding_sphere geometry_stage::get_bounds(const vertex* vertices, const uint32_t vertex_count)
+{
+	bounding_sphere bounds;
+	if (vertex_count == 0) return bounds;
+
+	vec3 low{ vertices[0].x, vertices[0].y, vertices[0].z };
+	vec3 high = low;
+	for (uint32_t i = 1; i < vertex_count; ++i)
+	{
+		low = { std::min(low.x, vertices[i].x), std::min(low.y, vertices[i].y), std::min(low.z, vertices[i].z) };
+		high = { std::max(high.x, vertices[i].x), std::max(high.y, vertices[i].y), std::max(high.z, vertices[i].z) };
+	}
+
+	bounds.center = { (low.x + high.x) / 2, (low.y + high.y) / 2, (low.z + high.z) / 2 };
+	for (uint32_t i = 0; i < vertex_count; ++i)
+	{
+		const vec3 offset{ vertices[i].x - bounds.center.x, vertices[i].y - bounds.center.y, vertices[i].z - bounds.center.z };
+		bounds.radius = std::max(bounds.radius, offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+	}
+	bounds.radius = std::sqrt(bounds.radius);
+	return bounds;
+}
+
+void geometry_stage::process(const mat_4& model_view_projection, const vertex* vertices, const uint32_t* indices,
+                             const uint32_t count, const uint32_t width, const uint32_t height, const bool clip,
+                             const cull_mode cull, std::vector<vertex>& out_vertices,
+                             std::vector<uint32_t>& out_indices, geometry_stats& stats)
+{
+	const auto matrix = to_mat<double>(model_view_projection);
+
+	// Direct mapped by index, indexed meshes reference the same vertices again within a few triangles.
+	cache_entry cache[vertex_cache_size];
+	for (auto& entry : cache) entry.index = no_index;
+
+	const auto fetch = [&](const uint32_t index) -> const cache_entry&
+	{
+		auto& entry = cache[index & (vertex_cache_size - 1)];
+		if (entry.index == index)
+		{
+			++stats.vertex_cache_hits;
+			return entry;
+		}
+
+		const auto& v = vertices[index];
+		const auto position = matrix * vec4d{ v.x, v.y, v.z, v.w };
+		entry.index = index;
+		entry.screen = no_index;
+		entry.vertex = clip_vertex{
+			{ position[0], position[1], position[2], position[3] },
+			{
+				static_cast<double>(v.color.a()), static_cast<double>(v.color.r()), static_cast<double>(v.color.g()),
+				static_cast<double>(v.color.b()), v.u, v.v
+			}
+		};
+		entry.code = outcode(entry.vertex);
+		++stats.vertices_transformed;
+		return entry;
+	};
+
+	stats.triangles += count;
+
+	// Each plane can add one vertex to a convex polygon, a triangle ends with at most nine.
+	clip_vertex polygon[2][9];
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t* corners = indices + i * 3;
+		uint32_t codes[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			const auto& entry = fetch(corners[k]);
+			polygon[0][k] = entry.vertex;
+			codes[k] = entry.code;
+		}
+
+		// All three outside the same plane, nothing can be visible.
+		if (clip && codes[0] & codes[1] & codes[2])
+		{
+			++stats.triangles_culled;
+			continue;
+		}
+
+		if (cull != cull_mode::none && is_culled(polygon[0], cull))
+		{
+			++stats.triangles_backfacing;
+			continue;
+		}
+
+		const uint32_t crossed = clip ? codes[0] | codes[1] | codes[2] : 0;
+		if (!crossed)
+		{
+			// Inside, shares the screen vertices of earlier triangles unless a corner collided in the cache.
+			for (int k = 0; k < 3; ++k)
+			{
+				auto& entry = cache[corners[k] & (vertex_cache_size - 1)];
+				if (entry.index != corners[k])
+				{
+					out_indices.push_back(static_cast<uint32_t>(out_vertices.size()));
+					out_vertices.push_back(to_screen(polygon[0][k], width, height));
+					continue;
+				}
+
+				if (entry.screen == no_index)
+				{
+					entry.screen = static_cast<uint32_t>(out_vertices.size());
+					out_vertices.push_back(to_screen(entry.vertex, width, height));
+				}
+				out_indices.push_back(entry.screen);
+			}
+			continue;
+		}
+
+		++stats.triangles_clipped;
+		uint32_t size = 3;
+		int current = 0;
+		for (int plane = 0; plane < 6 && size >= 3; ++plane)
+		{
+			if (!(crossed & 1u << plane)) continue;
+			size = clip_polygon(polygon[current], size, polygon[1 - current], plane);
+			current = 1 - current;
+		}
+
+		if (size < 3)
+		{
+			++stats.triangles_culled;
+			continue;
+		}
+
+		// Fan out the clipped polygon, its winding is the original triangle's.
+		const auto base = static_cast<uint32_t>(out_vertices.size());
+		for (uint32_t v = 0; v < size; ++v)
+		{
+			out_vertices.push_back(to_screen(polygon[current][v], width, height));
+		}
+		for (uint32_t v = 1; v + 1 < size; ++v)
+		{
+			out_indices.push_back(base);
+			out_indices.push_back(base + v);
+			out_indices.push_back(base + v + 1);
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "engine_data.h"
+
+// The six clip planes of a model-view-projection matrix, pulled back into object space.
+struct frustum
+{
+	// Plane i keeps a * x + b * y + c * z + d >= 0, normals are unit length so d is a distance.
+	double planes[6][4];
+};
+
+enum class cull_result
+{
+	outside,
+	intersecting,
+	inside
+};
+
+// Which faces draw_object drops by winding, front faces are counter-clockwise in normalized device coordinates.
+enum class cull_mode
+{
+	none,
+	back,
+	front
+};
+
+// Counters of the geometry work done since the last reset.
+struct geometry_stats
+{
+	uint64_t objects = 0;
+	uint64_t objects_culled = 0;
+	uint64_t triangles = 0;
+	uint64_t triangles_clipped = 0;
+	uint64_t triangles_culled = 0;
+	uint64_t triangles_backfacing = 0;
+	uint64_t vertices_transformed = 0;
+	uint64_t vertex_cache_hits = 0;
+};
+
+// Takes object space triangles through a model-view-projection matrix into screen space.
+// Clip space is 0 <= z <= w and -w <= x, y <= w (see mat_4::perspective). Triangles crossing a plane are
+// clipped against all six in homogeneous space (Sutherland-Hodgman), so everything handed to the
+// rasterizer lies on screen and in front of the camera.
+class geometry_stage
+{
+public:
+	static frustum get_frustum(const mat_4& model_view_projection);
+
+	static cull_result classify(const frustum& planes, const bounding_sphere& bounds);
+
+	// Smallest sphere around the axis aligned bounds of the vertices, good enough for culling.
+	static bounding_sphere get_bounds(const vertex* vertices, uint32_t vertex_count);
+
+	// Appends the screen space vertices and triangle indices of the visible parts of count indexed triangles.
+	// Screen vertex w keeps the clip w for perspective correct interpolation. Set clip to false when the
+	// object is known to be inside the frustum to skip all plane tests.
+	// Vertices are transformed once while they stay in a small post-transform cache, and triangles that are
+	// not clipped share their screen vertices. Culled faces are dropped before clipping.
+	static void process(const mat_4& model_view_projection, const vertex* vertices, const uint32_t* indices,
+	                    uint32_t count, uint32_t width, uint32_t height, bool clip, cull_mode cull,
+	                    std::vector<vertex>& out_vertices, std::vector<uint32_t>& out_indices,
+	                    geometry_stats& stats);
+};
@@ -0,0 +1,100 @@
+#include "headless_backend.h"
+
+#include <cstring>
+
+headless_backend::headless_backend(const headless_options& options): options_(options)
+{
+}
+
+headless_backend::~headless_backend()
+{
+	shutdown();
+}
+
+bool headless_backend::initialize(const char* title, const uint32_t width, const uint32_t height)
+{
+	(void)title;
+
+	width_ = width;
+	height_ = height;
+	frame_count_ = 0;
+
+	if (options_.mode == headless_mode::ring)
+	{
+		if (options_.ring_size == 0) return false;
+
+		ring_.assign(static_cast<size_t>(width) * height * options_.ring_size, 0);
+	}
+
+	if (options_.mode == headless_mode::stream)
+	{
+		stream_ = std::strcmp(options_.path, "-") == 0 ? stdout : std::fopen(options_.path, "wb");
+		if (!stream_) return false;
+	}
+
+	return true;
+}
+
+bool headless_backend::update(const uint32_t* pixels, const uint32_t pixel_count)
+{
+	if (options_.frame_limit && frame_count_ >= options_.frame_limit) return false;
+	if (pixel_count != width_ * height_) return false;
+
+	switch (options_.mode)
+	{
+	case headless_mode::discard:
+		break;
+	case headless_mode::ring:
+		{
+			// Slot of this frame, the oldest one gets overwritten.
+			const auto slot = static_cast<size_t>(frame_count_ % options_.ring_size) * pixel_count;
+			std::memcpy(&ring_[slot], pixels, pixel_count * sizeof(uint32_t));
+			break;
+		}
+	case headless_mode::stream:
+		if (std::fwrite(pixels, sizeof(uint32_t), pixel_count, stream_) != pixel_count) return false;
+		break;
+	}
+
+	last_frame_ = std::chrono::steady_clock::now();
+	if (frame_count_ == 0) first_frame_ = last_frame_;
+	++frame_count_;
+
+	return true;
+}
+
+bool headless_backend::shutdown()
+{
+	if (stream_)
+	{
+		std::fflush(stream_);
+		if (stream_ != stdout) std::fclose(stream_);
+		stream_ = nullptr;
+	}
+
+	ring_.clear();
+	ring_.shrink_to_fit();
+	return true;
+}
+
+double headless_backend::get_elapsed_seconds() const
+{
+	return std::chrono::duration<double>(last_frame_ - first_frame_).count();
+}
+
+double headless_backend::get_frames_per_second() const
+{
+	const auto elapsed = get_elapsed_seconds();
+
+	// The first frame only starts the clock.
+	return elapsed > 0 ? static_cast<double>(frame_count_ - 1) / elapsed : 0;
+}
+
+const uint32_t* headless_backend::get_ring_frame(const uint32_t age) const
+{
+	if (options_.mode != headless_mode::ring || age >= options_.ring_size || age >= frame_count_ || ring_.empty())
+		return nullptr;
+
+	const auto frame = frame_count_ - 1 - age;
+	return &ring_[static_cast<size_t>(frame % options_.ring_size) * width_ * height_];
+}
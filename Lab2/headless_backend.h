@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "surface_backend.h"
+
+enum class headless_mode
+{
+	// Frames are only counted, for measuring raw frame rate.
+	discard,
+	// The newest frames are kept in a ring of memory buffers.
+	ring,
+	// Every frame is written as raw 32 bit XRGB to a file or pipe.
+	stream
+};
+
+struct headless_options
+{
+	headless_mode mode = headless_mode::discard;
+
+	// Frames kept in memory by headless_mode::ring.
+	uint32_t ring_size = 4;
+
+	// File written by headless_mode::stream, "-" writes to stdout.
+	const char* path = "-";
+
+	// Update returns false after this many frames, zero never stops.
+	uint32_t frame_limit = 0;
+};
+
+// Presents without a window, every update is handled on the calling thread.
+class headless_backend final : public surface_backend
+{
+public:
+	explicit headless_backend(const headless_options& options = {});
+
+	~headless_backend() override;
+
+	headless_backend(const headless_backend& other) = delete;
+
+	headless_backend& operator=(const headless_backend& other) = delete;
+
+	bool initialize(const char* title, uint32_t width, uint32_t height) override;
+
+	bool update(const uint32_t* pixels, uint32_t pixel_count) override;
+
+	bool shutdown() override;
+
+	uint64_t get_frame_count() const { return frame_count_; }
+
+	// Seconds between the first and the latest presented frame.
+	double get_elapsed_seconds() const;
+
+	double get_frames_per_second() const;
+
+	// Frame presented age frames ago in ring mode, nullptr if it was never captured.
+	const uint32_t* get_ring_frame(uint32_t age = 0) const;
+
+private:
+	headless_options options_;
+	uint32_t width_ = 0;
+	uint32_t height_ = 0;
+
+	uint64_t frame_count_ = 0;
+	std::chrono::steady_clock::time_point first_frame_;
+	std::chrono::steady_clock::time_point last_frame_;
+
+	std::vector<uint32_t> ring_;
+	FILE* stream_ = nullptr;
+};
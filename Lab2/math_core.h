@@ -0,0 +1,351 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+#include "cpu_features.h"
+#include "engine_data.h"
+
+#ifdef LAB2_SSE2
+#include <emmintrin.h>
+#endif
+
+// Compile time trigonometry for the constexpr matrix builders.
+class const_math
+{
+public:
+	static constexpr double pi = 3.14159265358979323846;
+
+	// Wraps an angle into [-pi, pi].
+	static constexpr double wrap(const double angle)
+	{
+		const auto turns = static_cast<long long>(angle / (2 * pi) + (angle >= 0 ? 0.5 : -0.5));
+		return angle - static_cast<double>(turns) * (2 * pi);
+	}
+
+	static constexpr double sin(const double angle)
+	{
+		const double a = wrap(angle);
+		double term = a;
+		double sum = a;
+
+		// Taylor series, 15 terms reach double precision over [-pi, pi].
+		for (int n = 1; n < 16; ++n)
+		{
+			term *= -a * a / ((2.0 * n) * (2.0 * n + 1));
+			sum += term;
+		}
+		return sum;
+	}
+
+	static constexpr double cos(const double angle)
+	{
+		const double a = wrap(angle);
+		double term = 1;
+		double sum = 1;
+
+		for (int n = 1; n < 16; ++n)
+		{
+			term *= -a * a / ((2.0 * n - 1) * (2.0 * n));
+			sum += term;
+		}
+		return sum;
+	}
+};
+
+// N component vector of T, four component vectors are 16 byte aligned so float ones load straight into SSE.
+template <typename T, uint32_t N>
+struct alignas(N == 4 ? 16 : alignof(T)) vec
+{
+	T v[N];
+
+	constexpr vec() : v{}
+	{
+	}
+
+	template <typename... Args, typename = std::enable_if_t<sizeof...(Args) == N && N != 1>>
+	constexpr vec(const Args... args) : v{ static_cast<T>(args)... }
+	{
+	}
+
+	constexpr T& operator[](const uint32_t index) { return v[index]; }
+
+	constexpr const T& operator[](const uint32_t index) const { return v[index]; }
+
+	constexpr T x() const { return v[0]; }
+	constexpr T y() const { return v[1]; }
+	constexpr T z() const { return v[2]; }
+	constexpr T w() const { return v[3]; }
+
+	constexpr vec& operator+=(const vec& other)
+	{
+		for (uint32_t i = 0; i < N; ++i) v[i] += other.v[i];
+		return *this;
+	}
+
+	constexpr vec& operator-=(const vec& other)
+	{
+		for (uint32_t i = 0; i < N; ++i) v[i] -= other.v[i];
+		return *this;
+	}
+
+	constexpr vec& operator*=(const T scalar)
+	{
+		for (uint32_t i = 0; i < N; ++i) v[i] *= scalar;
+		return *this;
+	}
+
+	constexpr T squared_magnitude() const { return dot(*this, *this); }
+
+	static constexpr vec zero() { return {}; }
+
+	friend constexpr T dot(const vec& lhs, const vec& rhs)
+	{
+		T sum{};
+		for (uint32_t i = 0; i < N; ++i) sum += lhs.v[i] * rhs.v[i];
+		return sum;
+	}
+
+	friend constexpr bool operator==(const vec& lhs, const vec& rhs)
+	{
+		for (uint32_t i = 0; i < N; ++i)
+			if (lhs.v[i] != rhs.v[i]) return false;
+		return true;
+	}
+
+	friend constexpr bool operator!=(const vec& lhs, const vec& rhs)
+	{
+		return !(lhs == rhs);
+	}
+};
+
+template <typename T, uint32_t N>
+constexpr vec<T, N> operator+(vec<T, N> lhs, const vec<T, N>& rhs)
+{
+	return lhs += rhs;
+}
+
+template <typename T, uint32_t N>
+constexpr vec<T, N> operator-(vec<T, N> lhs, const vec<T, N>& rhs)
+{
+	return lhs -= rhs;
+}
+
+template <typename T, uint32_t N>
+constexpr vec<T, N> operator*(vec<T, N> lhs, const T scalar)
+{
+	return lhs *= scalar;
+}
+
+// N by N row major matrix, vectors are columns so transforms read out = m * v.
+template <typename T, uint32_t N>
+struct mat
+{
+	vec<T, N> m[N];
+
+	constexpr mat() : m{}
+	{
+	}
+
+	constexpr mat(const vec<T, N>& a, const vec<T, N>& b, const vec<T, N>& c, const vec<T, N>& d) : m{ a, b, c, d }
+	{
+		static_assert(N == 4, "Row constructor is only available on 4x4 matrices.");
+	}
+
+	constexpr vec<T, N>& operator[](const uint32_t row) { return m[row]; }
+
+	constexpr const vec<T, N>& operator[](const uint32_t row) const { return m[row]; }
+
+	constexpr mat transpose() const
+	{
+		mat result;
+		for (uint32_t r = 0; r < N; ++r)
+			for (uint32_t c = 0; c < N; ++c)
+				result.m[c][r] = m[r][c];
+		return result;
+	}
+
+	static constexpr mat identity()
+	{
+		mat result;
+		for (uint32_t i = 0; i < N; ++i) result.m[i][i] = 1;
+		return result;
+	}
+
+	static constexpr mat scale(const T size)
+	{
+		mat result = identity();
+		for (uint32_t i = 0; i + 1 < N; ++i) result.m[i][i] = size;
+		return result;
+	}
+
+	static constexpr mat translation(const T x, const T y, const T z)
+	{
+		mat result = identity();
+		result.m[0][3] = x;
+		result.m[1][3] = y;
+		result.m[2][3] = z;
+		return result;
+	}
+
+	// Rotation about x, matching mat_4::roll.
+	static constexpr mat roll(const double angle)
+	{
+		const T c = static_cast<T>(const_math::cos(angle));
+		const T s = static_cast<T>(const_math::sin(angle));
+		return {
+			{ 1, 0, 0, 0 },
+			{ 0, c, -s, 0 },
+			{ 0, s, c, 0 },
+			{ 0, 0, 0, 1 }
+		};
+	}
+
+	// Rotation about y, matching mat_4::pitch.
+	static constexpr mat pitch(const double angle)
+	{
+		const T c = static_cast<T>(const_math::cos(angle));
+		const T s = static_cast<T>(const_math::sin(angle));
+		return {
+			{ c, 0, s, 0 },
+			{ 0, 1, 0, 0 },
+			{ -s, 0, c, 0 },
+			{ 0, 0, 0, 1 }
+		};
+	}
+
+	// Rotation about z.
+	static constexpr mat yaw(const double angle)
+	{
+		const T c = static_cast<T>(const_math::cos(angle));
+		const T s = static_cast<T>(const_math::sin(angle));
+		return {
+			{ c, -s, 0, 0 },
+			{ s, c, 0, 0 },
+			{ 0, 0, 1, 0 },
+			{ 0, 0, 0, 1 }
+		};
+	}
+
+	friend constexpr bool operator==(const mat& lhs, const mat& rhs)
+	{
+		for (uint32_t i = 0; i < N; ++i)
+			if (lhs.m[i] != rhs.m[i]) return false;
+		return true;
+	}
+
+	friend constexpr bool operator!=(const mat& lhs, const mat& rhs)
+	{
+		return !(lhs == rhs);
+	}
+};
+
+template <typename T, uint32_t N>
+constexpr mat<T, N> operator*(const mat<T, N>& lhs, const mat<T, N>& rhs)
+{
+	mat<T, N> result;
+	for (uint32_t r = 0; r < N; ++r)
+		for (uint32_t k = 0; k < N; ++k)
+			for (uint32_t c = 0; c < N; ++c)
+				result.m[r][c] += lhs.m[r][k] * rhs.m[k][c];
+	return result;
+}
+
+template <typename T, uint32_t N>
+constexpr vec<T, N> operator*(const mat<T, N>& lhs, const vec<T, N>& rhs)
+{
+	vec<T, N> result;
+	for (uint32_t r = 0; r < N; ++r) result[r] = dot(lhs.m[r], rhs);
+	return result;
+}
+
+using vec2f = vec<float, 2>;
+using vec3f = vec<float, 3>;
+using vec4f = vec<float, 4>;
+using vec4d = vec<double, 4>;
+using mat4f = mat<float, 4>;
+using mat4d = mat<double, 4>;
+
+#ifdef LAB2_SSE2
+
+// Single precision 4 wide operations run on SSE, these overloads win over the constexpr templates.
+
+inline vec4f operator+(const vec4f& lhs, const vec4f& rhs)
+{
+	vec4f result;
+	_mm_store_ps(result.v, _mm_add_ps(_mm_load_ps(lhs.v), _mm_load_ps(rhs.v)));
+	return result;
+}
+
+inline vec4f operator-(const vec4f& lhs, const vec4f& rhs)
+{
+	vec4f result;
+	_mm_store_ps(result.v, _mm_sub_ps(_mm_load_ps(lhs.v), _mm_load_ps(rhs.v)));
+	return result;
+}
+
+inline vec4f operator*(const vec4f& lhs, const float scalar)
+{
+	vec4f result;
+	_mm_store_ps(result.v, _mm_mul_ps(_mm_load_ps(lhs.v), _mm_set1_ps(scalar)));
+	return result;
+}
+
+inline mat4f operator*(const mat4f& lhs, const mat4f& rhs)
+{
+	const __m128 b0 = _mm_load_ps(rhs.m[0].v);
+	const __m128 b1 = _mm_load_ps(rhs.m[1].v);
+	const __m128 b2 = _mm_load_ps(rhs.m[2].v);
+	const __m128 b3 = _mm_load_ps(rhs.m[3].v);
+
+	// Each result row is the rows of rhs weighted by one row of lhs.
+	mat4f result;
+	for (uint32_t r = 0; r < 4; ++r)
+	{
+		const auto& a = lhs.m[r].v;
+		const __m128 lo = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[0]), b0), _mm_mul_ps(_mm_set1_ps(a[1]), b1));
+		const __m128 hi = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[2]), b2), _mm_mul_ps(_mm_set1_ps(a[3]), b3));
+		_mm_store_ps(result.m[r].v, _mm_add_ps(lo, hi));
+	}
+	return result;
+}
+
+inline vec4f operator*(const mat4f& lhs, const vec4f& rhs)
+{
+	// Transposed the rows become columns, the product is then four broadcast multiply adds.
+	__m128 c0 = _mm_load_ps(lhs.m[0].v);
+	__m128 c1 = _mm_load_ps(lhs.m[1].v);
+	__m128 c2 = _mm_load_ps(lhs.m[2].v);
+	__m128 c3 = _mm_load_ps(lhs.m[3].v);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+	const __m128 lo = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(rhs.v[0])), _mm_mul_ps(c1, _mm_set1_ps(rhs.v[1])));
+	const __m128 hi = _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(rhs.v[2])), _mm_mul_ps(c3, _mm_set1_ps(rhs.v[3])));
+
+	vec4f result;
+	_mm_store_ps(result.v, _mm_add_ps(lo, hi));
+	return result;
+}
+
+#endif
+
+// Converts from the double precision engine matrix. Objects, the scene graph and recorded commands keep mat_4,
+// the per vertex paths (geometry_stage, soa_mesh) convert once per draw and transform with vec4d or mat4f.
+template <typename T>
+mat<T, 4> to_mat(const mat_4& matrix)
+{
+	mat<T, 4> result;
+	for (uint32_t r = 0; r < 4; ++r)
+		for (uint32_t c = 0; c < 4; ++c)
+			result.m[r][c] = static_cast<T>(matrix.m[r][c]);
+	return result;
+}
+
+template <typename T>
+mat_4 to_mat_4(const mat<T, 4>& matrix)
+{
+	mat_4 result;
+	for (uint32_t r = 0; r < 4; ++r)
+		for (uint32_t c = 0; c < 4; ++c)
+			result.m[r][c] = static_cast<double>(matrix.m[r][c]);
+	return result;
+}
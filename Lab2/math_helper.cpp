@@ -1,5 +1,6 @@
 #include "math_helper.h"
 #include "engine_data.h"
+#include "math_kernels.h"
 
 vec2 math_helper::get_parallel_vec(const vec2& a, const vec2& b)
 {
@@ -13,12 +14,12 @@ vec2 math_helper::get_gradient_vec(const vec2& a, const vec2& b)
 
 double math_helper::lerp_d(const double& a, const double& b, const float ratio)
 {
-	return (b - a) * static_cast<double>(ratio) + a;
+	return math_kernels::lerp(a, b, static_cast<double>(ratio));
 }
 
 float math_helper::lerp_f(const double& a, const double& b, const float ratio)
 {
-	return static_cast<float>((b - a) * static_cast<double>(ratio) + a);
+	return math_kernels::lerp(static_cast<float>(a), static_cast<float>(b), ratio);
 }
 
 uint32_t math_helper::floor(const double a)
@@ -37,10 +38,6 @@ double math_helper::solve_line(const double& cur_x, const vec2& p1, const vec2&
 
 double math_helper::solve_line_2(const double& x, const vec2& p1, const vec2& p2)
 {
-	vec2 max;
-	vec2 min;
-	get_min_and_max_x(min, max, p1, p2);
-
 	return (p2.y - p1.y) / (p2.x - p1.x) * (x - p1.x) + p1.y;
 }
 
@@ -79,12 +76,6 @@ void math_helper::get_min_and_max_y(vec2& min, vec2& max, const vec2& start, con
 
 double math_helper::sqrt(const double square)
 {
-	double root = square / 3, diff = 1;
-	if (square <= 0) return 0;
-	do {
-		const double last = root;
-		root = (root + square / root) / 2;
-		diff = root - last;
-	} while (diff > MINDIFF || diff < -MINDIFF);
-	return root;
+	if (!(square > 0)) return 0;
+	return math_kernels::sqrt(square);
 }
@@ -26,7 +26,7 @@ public:
 
 	static void get_min_and_max_y(vec2& min, vec2& max, const vec2& start, const vec2& end);
 
-	// Credit of Weather Vane https://stackoverflow.com/questions/29018864/any-way-to-obtain-square-root-of-a-number-without-using-math-h-and-sqrt
+	// Hardware square root, zero for anything not positive.
 	static double sqrt(const double square);
 };
 
@@ -0,0 +1,340 @@
+#include "math_kernels.h"
+
+#ifdef LAB2_SSE2
+#include <immintrin.h>
+#endif
+
+static constexpr float two_over_pi = 0.636619772367581343f;
+
+// pi / 2 in three parts, the first two short enough that their products with a quadrant below 2^15 are exact.
+static constexpr float half_pi_1 = 1.5703125f;
+static constexpr float half_pi_2 = 4.837512969970703125e-4f;
+static constexpr float half_pi_3 = 7.54978995489188216e-8f;
+
+// sin(r) = r + r * z * sine(z) and cos(r) = 1 - z / 2 + z * z * cosine(z) with z = r * r, highest power first.
+struct polynomial
+{
+	uint32_t sine_terms;
+	float sine[3];
+	uint32_t cosine_terms;
+	float cosine[3];
+};
+
+static constexpr polynomial polynomials[] = {
+	{ 2, { 1.0f / 120, -1.0f / 6 }, 1, { 1.0f / 24 } },
+	{ 3, { -1.0f / 5040, 1.0f / 120, -1.0f / 6 }, 2, { -1.0f / 720, 1.0f / 24 } },
+	// Cephes sinf and cosf.
+	{ 3, { -1.9515295891e-4f, 8.3321608736e-3f, -1.6666654611e-1f }, 3,
+	  { 2.443315711809948e-5f, -1.388731625493765e-3f, 4.166664568298827e-2f } }
+};
+
+void math_kernels::sincos(const float angle, float& sine, float& cosine, const approximation accuracy)
+{
+	const auto& p = polynomials[static_cast<int>(accuracy)];
+
+	const auto quadrant = static_cast<int32_t>(std::nearbyint(angle * two_over_pi));
+	const auto q = static_cast<float>(quadrant);
+	const float r = angle - q * half_pi_1 - q * half_pi_2 - q * half_pi_3;
+	const float z = r * r;
+
+	float ps = p.sine[0];
+	for (uint32_t k = 1; k < p.sine_terms; ++k) ps = ps * z + p.sine[k];
+	float pc = p.cosine[0];
+	for (uint32_t k = 1; k < p.cosine_terms; ++k) pc = pc * z + p.cosine[k];
+
+	const float s = r + r * z * ps;
+	const float c = (1.0f - 0.5f * z) + z * z * pc;
+
+	switch (quadrant & 3)
+	{
+	case 0: sine = s; cosine = c; break;
+	case 1: sine = c; cosine = -s; break;
+	case 2: sine = -s; cosine = -c; break;
+	default: sine = -c; cosine = s; break;
+	}
+}
+
+#pragma region scalar
+
+static void sqrt_scalar(const float* in, float* out, const size_t count)
+{
+	for (size_t i = 0; i < count; ++i) out[i] = math_kernels::sqrt(in[i]);
+}
+
+static void rsqrt_scalar(const float* in, float* out, const size_t count, const bool refine)
+{
+	for (size_t i = 0; i < count; ++i) out[i] = math_kernels::rsqrt(in[i], refine ? 1 : 0);
+}
+
+static void sincos_scalar(const float* angles, float* sines, float* cosines, const size_t count,
+                          const approximation accuracy)
+{
+	for (size_t i = 0; i < count; ++i) math_kernels::sincos(angles[i], sines[i], cosines[i], accuracy);
+}
+
+static void normalize_scalar(float* x, float* y, float* z, const size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float length_squared = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+		const float scale = length_squared > 0 ? math_kernels::rsqrt(length_squared) : 0.0f;
+		x[i] *= scale;
+		y[i] *= scale;
+		z[i] *= scale;
+	}
+}
+
+static void lerp_scalar(const float* a, const float* b, const float t, float* out, const size_t count)
+{
+	for (size_t i = 0; i < count; ++i) out[i] = math_kernels::lerp(a[i], b[i], t);
+}
+
+#pragma endregion
+
+#ifdef LAB2_SSE2
+
+#pragma region sse2
+
+static void sqrt_sse2(const float* in, float* out, const size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) _mm_storeu_ps(out + i, _mm_sqrt_ps(_mm_loadu_ps(in + i)));
+	sqrt_scalar(in + i, out + i, count - i);
+}
+
+// One Newton step, y * (1.5 - 0.5 * x * y * y) in the order math_kernels::rsqrt rounds it.
+static __m128 refine_rsqrt_sse2(const __m128 x, const __m128 y)
+{
+	const __m128 t = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), x), y), y);
+	return _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), t));
+}
+
+static void rsqrt_sse2(const float* in, float* out, const size_t count, const bool refine)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(in + i);
+		const __m128 y = _mm_rsqrt_ps(x);
+		_mm_storeu_ps(out + i, refine ? refine_rsqrt_sse2(x, y) : y);
+	}
+	rsqrt_scalar(in + i, out + i, count - i, refine);
+}
+
+static __m128 horner_sse2(const float* coefficients, const uint32_t terms, const __m128 z)
+{
+	__m128 p = _mm_set1_ps(coefficients[0]);
+	for (uint32_t k = 1; k < terms; ++k) p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(coefficients[k]));
+	return p;
+}
+
+static void sincos_sse2(const float* angles, float* sines, float* cosines, const size_t count,
+                        const approximation accuracy)
+{
+	const auto& p = polynomials[static_cast<int>(accuracy)];
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i two = _mm_set1_epi32(2);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 angle = _mm_loadu_ps(angles + i);
+		const __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(two_over_pi)));
+		const __m128 q = _mm_cvtepi32_ps(quadrant);
+
+		__m128 r = _mm_sub_ps(angle, _mm_mul_ps(q, _mm_set1_ps(half_pi_1)));
+		r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(half_pi_2)));
+		r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(half_pi_3)));
+		const __m128 z = _mm_mul_ps(r, r);
+
+		const __m128 s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), horner_sse2(p.sine, p.sine_terms, z)));
+		const __m128 c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), z)),
+		                            _mm_mul_ps(_mm_mul_ps(z, z), horner_sse2(p.cosine, p.cosine_terms, z)));
+
+		// Odd quadrants swap sine and cosine, bit 1 of the quadrant and of the next one give the signs.
+		const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+		const __m128 sine_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+		const __m128 cosine_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+
+		_mm_storeu_ps(sines + i, _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sine_sign));
+		_mm_storeu_ps(cosines + i, _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cosine_sign));
+	}
+	sincos_scalar(angles + i, sines + i, cosines + i, count - i, accuracy);
+}
+
+static void normalize_sse2(float* x, float* y, float* z, const size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 vx = _mm_loadu_ps(x + i);
+		const __m128 vy = _mm_loadu_ps(y + i);
+		const __m128 vz = _mm_loadu_ps(z + i);
+
+		const __m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+		const __m128 non_zero = _mm_cmpgt_ps(length_squared, _mm_setzero_ps());
+		const __m128 scale = _mm_and_ps(non_zero, refine_rsqrt_sse2(length_squared, _mm_rsqrt_ps(length_squared)));
+
+		_mm_storeu_ps(x + i, _mm_mul_ps(vx, scale));
+		_mm_storeu_ps(y + i, _mm_mul_ps(vy, scale));
+		_mm_storeu_ps(z + i, _mm_mul_ps(vz, scale));
+	}
+	normalize_scalar(x + i, y + i, z + i, count - i);
+}
+
+static void lerp_sse2(const float* a, const float* b, const float t, float* out, const size_t count)
+{
+	const __m128 weight = _mm_set1_ps(t);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 start = _mm_loadu_ps(a + i);
+		_mm_storeu_ps(out + i, _mm_add_ps(start, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b + i), start), weight)));
+	}
+	lerp_scalar(a + i, b + i, t, out + i, count - i);
+}
+
+#pragma endregion
+
+#pragma region avx2
+
+// gcc would fuse the multiplies and adds with fma enabled, which rounds differently from the other sets.
+
+LAB2_TARGET_AVX2_NO_FMA static void sqrt_avx2(const float* in, float* out, const size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) _mm256_storeu_ps(out + i, _mm256_sqrt_ps(_mm256_loadu_ps(in + i)));
+	sqrt_sse2(in + i, out + i, count - i);
+}
+
+LAB2_TARGET_AVX2_NO_FMA static __m256 refine_rsqrt_avx2(const __m256 x, const __m256 y)
+{
+	const __m256 t = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), x), y), y);
+	return _mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(1.5f), t));
+}
+
+LAB2_TARGET_AVX2_NO_FMA static void rsqrt_avx2(const float* in, float* out, const size_t count, const bool refine)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256 x = _mm256_loadu_ps(in + i);
+		const __m256 y = _mm256_rsqrt_ps(x);
+		_mm256_storeu_ps(out + i, refine ? refine_rsqrt_avx2(x, y) : y);
+	}
+	rsqrt_sse2(in + i, out + i, count - i, refine);
+}
+
+LAB2_TARGET_AVX2_NO_FMA static __m256 horner_avx2(const float* coefficients, const uint32_t terms, const __m256 z)
+{
+	__m256 p = _mm256_set1_ps(coefficients[0]);
+	for (uint32_t k = 1; k < terms; ++k) p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(coefficients[k]));
+	return p;
+}
+
+LAB2_TARGET_AVX2_NO_FMA static void sincos_avx2(const float* angles, float* sines, float* cosines, const size_t count,
+                                         const approximation accuracy)
+{
+	const auto& p = polynomials[static_cast<int>(accuracy)];
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i two = _mm256_set1_epi32(2);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256 angle = _mm256_loadu_ps(angles + i);
+		const __m256i quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(angle, _mm256_set1_ps(two_over_pi)));
+		const __m256 q = _mm256_cvtepi32_ps(quadrant);
+
+		__m256 r = _mm256_sub_ps(angle, _mm256_mul_ps(q, _mm256_set1_ps(half_pi_1)));
+		r = _mm256_sub_ps(r, _mm256_mul_ps(q, _mm256_set1_ps(half_pi_2)));
+		r = _mm256_sub_ps(r, _mm256_mul_ps(q, _mm256_set1_ps(half_pi_3)));
+		const __m256 z = _mm256_mul_ps(r, r);
+
+		const __m256 s = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, z), horner_avx2(p.sine, p.sine_terms, z)));
+		const __m256 c = _mm256_add_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_set1_ps(0.5f), z)),
+		                               _mm256_mul_ps(_mm256_mul_ps(z, z), horner_avx2(p.cosine, p.cosine_terms, z)));
+
+		const __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, one), one));
+		const __m256 sine_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, two), 30));
+		const __m256 cosine_sign =
+			_mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, one), two), 30));
+
+		_mm256_storeu_ps(sines + i, _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sine_sign));
+		_mm256_storeu_ps(cosines + i, _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cosine_sign));
+	}
+	sincos_sse2(angles + i, sines + i, cosines + i, count - i, accuracy);
+}
+
+LAB2_TARGET_AVX2_NO_FMA static void normalize_avx2(float* x, float* y, float* z, const size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256 vx = _mm256_loadu_ps(x + i);
+		const __m256 vy = _mm256_loadu_ps(y + i);
+		const __m256 vz = _mm256_loadu_ps(z + i);
+
+		const __m256 length_squared =
+			_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz));
+		const __m256 non_zero = _mm256_cmp_ps(length_squared, _mm256_setzero_ps(), _CMP_GT_OQ);
+		const __m256 scale = _mm256_and_ps(non_zero, refine_rsqrt_avx2(length_squared, _mm256_rsqrt_ps(length_squared)));
+
+		_mm256_storeu_ps(x + i, _mm256_mul_ps(vx, scale));
+		_mm256_storeu_ps(y + i, _mm256_mul_ps(vy, scale));
+		_mm256_storeu_ps(z + i, _mm256_mul_ps(vz, scale));
+	}
+	normalize_sse2(x + i, y + i, z + i, count - i);
+}
+
+LAB2_TARGET_AVX2_NO_FMA static void lerp_avx2(const float* a, const float* b, const float t, float* out,
+                                              const size_t count)
+{
+	const __m256 weight = _mm256_set1_ps(t);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256 start = _mm256_loadu_ps(a + i);
+		_mm256_storeu_ps(out + i, _mm256_add_ps(start, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(b + i), start),
+		                                                             weight)));
+	}
+	lerp_sse2(a + i, b + i, t, out + i, count - i);
+}
+
+#pragma endregion
+
+#endif
+
+const math_kernels& math_kernels::scalar()
+{
+	static const math_kernels kernels{
+		"scalar", sqrt_scalar, rsqrt_scalar, sincos_scalar, normalize_scalar, lerp_scalar
+	};
+	return kernels;
+}
+
+const math_kernels* math_kernels::sse2()
+{
+#ifdef LAB2_SSE2
+	static const math_kernels kernels{ "sse2", sqrt_sse2, rsqrt_sse2, sincos_sse2, normalize_sse2, lerp_sse2 };
+	if (cpu_features::get().sse2) return &kernels;
+#endif
+	return nullptr;
+}
+
+const math_kernels* math_kernels::avx2()
+{
+#ifdef LAB2_SSE2
+	static const math_kernels kernels{ "avx2", sqrt_avx2, rsqrt_avx2, sincos_avx2, normalize_avx2, lerp_avx2 };
+	if (cpu_features::get().avx2) return &kernels;
+#endif
+	return nullptr;
+}
+
+const math_kernels& math_kernels::get()
+{
+	static const math_kernels& kernels = avx2() ? *avx2() : sse2() ? *sse2() : scalar();
+	return kernels;
+}
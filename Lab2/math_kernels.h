@@ -0,0 +1,137 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "cpu_features.h"
+
+#ifdef LAB2_SSE2
+#include <emmintrin.h>
+#endif
+
+// Polynomial used by the float sine and cosine, with the worst absolute error over |angle| <= 1e4.
+enum class approximation : uint8_t
+{
+	// Degree 5 sine and 4 cosine, 4e-4.
+	fast,
+	// Degree 7 sine and 6 cosine, 4e-6.
+	balanced,
+	// Minimax degree 7 sine and 8 cosine, 1e-7 which is float precision.
+	precise
+};
+
+// Square roots and trigonometry for per vertex and per object work, and span kernels applying them to arrays.
+// The best set the cpu supports is picked at runtime, every set produces exactly the same results as the scalar
+// one, so none of them uses fused multiply add.
+struct math_kernels
+{
+	const char* name;
+
+	// out = sqrt(in), correctly rounded.
+	void (*sqrt_span)(const float* in, float* out, size_t count);
+
+	// out = rsqrt(in, refine ? 1 : 0).
+	void (*rsqrt_span)(const float* in, float* out, size_t count, bool refine);
+
+	void (*sincos_span)(const float* angles, float* sines, float* cosines, size_t count, approximation accuracy);
+
+	// Scales every (x, y, z) of three streams to unit length, zero vectors stay zero.
+	void (*normalize_span)(float* x, float* y, float* z, size_t count);
+
+	// out = lerp(a, b, t) for every pair of a and b.
+	void (*lerp_span)(const float* a, const float* b, float t, float* out, size_t count);
+
+	// Fastest set supported by this cpu.
+	static const math_kernels& get();
+
+	static const math_kernels& scalar();
+
+	// nullptr when the cpu or the build lacks the instruction set.
+	static const math_kernels* sse2();
+
+	static const math_kernels* avx2();
+
+	// Single instruction square root, without the errno check std::sqrt may carry.
+	static double sqrt(const double x)
+	{
+#ifdef LAB2_SSE2
+		const __m128d v = _mm_set_sd(x);
+		return _mm_cvtsd_f64(_mm_sqrt_sd(v, v));
+#else
+		return std::sqrt(x);
+#endif
+	}
+
+	static float sqrt(const float x)
+	{
+#ifdef LAB2_SSE2
+		return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
+#else
+		return std::sqrt(x);
+#endif
+	}
+
+	// 1 / sqrt(x) for positive x. The hardware estimate has 12 bits, each Newton step about doubles them and one
+	// reaches float precision.
+	static float rsqrt(const float x, const int refinements = 1)
+	{
+#ifdef LAB2_SSE2
+		float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+#else
+		float y = 1.0f / std::sqrt(x);
+#endif
+		for (int i = 0; i < refinements; ++i) y = y * (1.5f - 0.5f * x * y * y);
+		return y;
+	}
+
+	// Sine and cosine of one angle from a single range reduction, within two ulps of std::sin and std::cos.
+	static void sincos(const double angle, double& sine, double& cosine)
+	{
+		// Beyond this the three part reduction loses bits, the library does a full one.
+		if (!(std::fabs(angle) < 1e5))
+		{
+			sine = std::sin(angle);
+			cosine = std::cos(angle);
+			return;
+		}
+
+		// pi / 2 split so every product with the quadrant is exact.
+		const double quadrant = std::nearbyint(angle * 0.63661977236758134308);
+		const double r = angle - quadrant * 1.57079632673412561417e+00 - quadrant * 6.07710050630396597660e-11 -
+			quadrant * 2.02226624879595063154e-21;
+		const double z = r * r;
+
+		// fdlibm minimax polynomials over [-pi / 4, pi / 4].
+		const double s = r + r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 +
+			z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06 +
+				z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+		const double half_z = 0.5 * z;
+		const double w = 1.0 - half_z;
+		const double c = w + (((1.0 - w) - half_z) + z * z * (4.16666666666666019037e-02 +
+			z * (-1.38888888888741095749e-03 + z * (2.48015872894767294178e-05 +
+				z * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 +
+					z * -1.13596475577881948265e-11))))));
+
+		switch (static_cast<int64_t>(quadrant) & 3)
+		{
+		case 0: sine = s; cosine = c; break;
+		case 1: sine = c; cosine = -s; break;
+		case 2: sine = -s; cosine = -c; break;
+		default: sine = -c; cosine = s; break;
+		}
+	}
+
+	// a + (b - a) * t, t of 0 gives a exactly.
+	static float lerp(const float a, const float b, const float t)
+	{
+		return a + (b - a) * t;
+	}
+
+	static double lerp(const double a, const double b, const double t)
+	{
+		return a + (b - a) * t;
+	}
+
+	// Float sine and cosine by polynomial, the scalar form of sincos_span. Meant for |angle| <= 1e4.
+	static void sincos(const float angle, float& sine, float& cosine, const approximation accuracy = approximation::precise);
+};
@@ -0,0 +1,366 @@
+#include "mesh_loader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "base_object.h"
+#include "geometry_stage.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	static_assert(std::is_trivially_copyable<vertex>::value, "vertices are written and mapped as raw bytes");
+
+	constexpr uint32_t mesh_magic = 0x534D324C; // "L2MS"
+	constexpr uint32_t mesh_version = 2;
+	constexpr uint64_t stream_alignment = 64;
+
+	struct mesh_header
+	{
+		uint32_t magic;
+		uint32_t version;
+		// sizeof(vertex) of the writer, the streams are only usable by a build with the same layout.
+		uint32_t vertex_size;
+		uint32_t vertex_count;
+		uint32_t index_count;
+		uint32_t reserved;
+		uint64_t vertex_offset;
+		uint64_t index_offset;
+		double bounds[4];
+	};
+
+	uint64_t align_up(const uint64_t offset)
+	{
+		return (offset + stream_alignment - 1) / stream_alignment * stream_alignment;
+	}
+
+	bool read_file(const char* path, std::vector<char>& text)
+	{
+		FILE* file = std::fopen(path, "rb");
+		if (!file) return false;
+
+		bool read = std::fseek(file, 0, SEEK_END) == 0;
+		const long size = read ? std::ftell(file) : -1;
+		read = size >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+		if (read)
+		{
+			// Terminated so numbers can be parsed straight out of the buffer.
+			text.resize(static_cast<size_t>(size) + 1);
+			read = std::fread(text.data(), 1, static_cast<size_t>(size), file) == static_cast<size_t>(size);
+			text.back() = '\0';
+		}
+
+		std::fclose(file);
+		return read;
+	}
+
+	bool is_blank(const char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* skip_blanks(const char* cursor)
+	{
+		while (is_blank(*cursor)) ++cursor;
+		return cursor;
+	}
+
+	const char* next_line(const char* cursor)
+	{
+		while (*cursor && *cursor != '\n') ++cursor;
+		return *cursor ? cursor + 1 : cursor;
+	}
+
+	// Reads up to count numbers from the rest of the line, returns how many there were.
+	int read_numbers(const char*& cursor, double* values, const int count)
+	{
+		int read = 0;
+		while (read < count)
+		{
+			char* end;
+			const double value = std::strtod(skip_blanks(cursor), &end);
+			if (end == skip_blanks(cursor)) break;
+			values[read++] = value;
+			cursor = end;
+		}
+		return read;
+	}
+
+	// OBJ indices are one based, negative ones count back from the newest record. Zero is absent.
+	bool resolve_index(const long index, const size_t count, uint32_t& resolved)
+	{
+		const long long position = index < 0 ? static_cast<long long>(count) + index : index - 1;
+		if (position < 0 || position >= static_cast<long long>(count)) return false;
+
+		resolved = static_cast<uint32_t>(position);
+		return true;
+	}
+}
+
+bool mesh_loader::load_obj(const char* path, std::vector<vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<char> text;
+	if (!read_file(path, text)) return false;
+
+	const color white(0xFFFFFFFFu);
+	std::vector<vertex> positions;
+	std::vector<std::pair<double, double>> coordinates;
+
+	// Position and texture coordinate index pair to output vertex.
+	std::unordered_map<uint64_t, uint32_t> unique;
+	std::vector<uint32_t> polygon;
+
+	vertices.clear();
+	indices.clear();
+
+	for (const char* line = text.data(); *line; line = next_line(line))
+	{
+		const char* cursor = skip_blanks(line);
+
+		if (cursor[0] == 'v' && is_blank(cursor[1]))
+		{
+			++cursor;
+			double values[6];
+			const int count = read_numbers(cursor, values, 6);
+			if (count < 3) return false;
+
+			vertex position(values[0], values[1], values[2], 1, white);
+			if (count == 6)
+			{
+				const auto channel = [](const double value)
+				{
+					return static_cast<uint8_t>((value < 0 ? 0 : value > 1 ? 1 : value) * 255 + 0.5);
+				};
+				position.color = color(channel(values[3]), channel(values[4]), channel(values[5]));
+			}
+			positions.push_back(position);
+		}
+		else if (cursor[0] == 'v' && cursor[1] == 't' && is_blank(cursor[2]))
+		{
+			cursor += 2;
+			double values[2] = {};
+			if (read_numbers(cursor, values, 2) < 1) return false;
+			coordinates.emplace_back(values[0], values[1]);
+		}
+		else if (cursor[0] == 'f' && is_blank(cursor[1]))
+		{
+			++cursor;
+			polygon.clear();
+
+			// Corners are p, p/t, p//n or p/t/n, normals are not used.
+			while (*(cursor = skip_blanks(cursor)) && *cursor != '\n')
+			{
+				char* end;
+				uint32_t position, coordinate = 0xFFFFFFFF;
+				if (!resolve_index(std::strtol(cursor, &end, 10), positions.size(), position)) return false;
+				cursor = end;
+
+				if (*cursor == '/' && cursor[1] != '/')
+				{
+					if (!resolve_index(std::strtol(cursor + 1, &end, 10), coordinates.size(), coordinate)) return false;
+					cursor = end;
+				}
+				while (*cursor && !is_blank(*cursor) && *cursor != '\n') ++cursor;
+
+				const uint64_t key = static_cast<uint64_t>(position) << 32 | coordinate;
+				const auto found = unique.emplace(key, static_cast<uint32_t>(vertices.size()));
+				if (found.second)
+				{
+					vertices.push_back(positions[position]);
+					if (coordinate != 0xFFFFFFFF)
+					{
+						vertices.back().u = coordinates[coordinate].first;
+						vertices.back().v = coordinates[coordinate].second;
+					}
+				}
+				polygon.push_back(found.first->second);
+			}
+
+			if (polygon.size() < 3) return false;
+			for (size_t i = 1; i + 1 < polygon.size(); ++i)
+			{
+				indices.push_back(polygon[0]);
+				indices.push_back(polygon[i]);
+				indices.push_back(polygon[i + 1]);
+			}
+		}
+	}
+
+	return true;
+}
+
+std::unique_ptr<base_object> mesh_loader::import_obj(const char* path, const mat_4& world_matrix)
+{
+	std::vector<vertex> vertices;
+	std::vector<uint32_t> indices;
+	if (!load_obj(path, vertices, indices)) return nullptr;
+
+	mesh_storage geometry(static_cast<uint32_t>(vertices.size()), static_cast<uint32_t>(indices.size()));
+	std::copy(vertices.begin(), vertices.end(), geometry.get_vertices());
+	std::copy(indices.begin(), indices.end(), geometry.get_indices());
+
+	return std::unique_ptr<base_object>(new base_object(std::move(geometry), world_matrix));
+}
+
+bool mesh_loader::write_binary(const char* path, const vertex* vertices, const uint32_t vertex_count,
+                               const uint32_t* indices, const uint32_t index_count)
+{
+	const auto bounds = geometry_stage::get_bounds(vertices, vertex_count);
+
+	mesh_header header = {};
+	header.magic = mesh_magic;
+	header.version = mesh_version;
+	header.vertex_size = sizeof(vertex);
+	header.vertex_count = vertex_count;
+	header.index_count = index_count;
+	header.vertex_offset = align_up(sizeof(mesh_header));
+	header.index_offset = align_up(header.vertex_offset + static_cast<uint64_t>(vertex_count) * sizeof(vertex));
+	header.bounds[0] = bounds.center.x;
+	header.bounds[1] = bounds.center.y;
+	header.bounds[2] = bounds.center.z;
+	header.bounds[3] = bounds.radius;
+
+	FILE* file = std::fopen(path, "wb");
+	if (!file) return false;
+
+	const char padding[stream_alignment] = {};
+	const size_t vertex_padding = static_cast<size_t>(header.vertex_offset - sizeof(mesh_header));
+	const size_t index_padding = static_cast<size_t>(header.index_offset - header.vertex_offset -
+		static_cast<uint64_t>(vertex_count) * sizeof(vertex));
+
+	bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+	written = written && std::fwrite(padding, 1, vertex_padding, file) == vertex_padding;
+	written = written && std::fwrite(vertices, sizeof(vertex), vertex_count, file) == vertex_count;
+	written = written && std::fwrite(padding, 1, index_padding, file) == index_padding;
+	written = written && std::fwrite(indices, sizeof(uint32_t), index_count, file) == index_count;
+
+	return std::fclose(file) == 0 && written;
+}
+
+mapped_mesh::~mapped_mesh()
+{
+	close();
+}
+
+mapped_mesh::mapped_mesh(mapped_mesh&& other) noexcept: data_(other.data_),
+                                                        size_(other.size_),
+                                                        view_(other.view_)
+{
+	other.data_ = nullptr;
+	other.size_ = 0;
+	other.view_ = mesh_view();
+}
+
+mapped_mesh& mapped_mesh::operator=(mapped_mesh&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	std::swap(data_, other.data_);
+	std::swap(size_, other.size_);
+	std::swap(view_, other.view_);
+	return *this;
+}
+
+bool mapped_mesh::open(const char* path)
+{
+	close();
+
+	// The mapping outlives the handles it was created from.
+#ifdef _WIN32
+	const HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                                FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size;
+	const HANDLE mapping = GetFileSizeEx(file, &size) && size.QuadPart > 0
+		                       ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)
+		                       : nullptr;
+	CloseHandle(file);
+	if (!mapping) return false;
+
+	data_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!data_) return false;
+	size_ = static_cast<size_t>(size.QuadPart);
+#else
+	const int file = ::open(path, O_RDONLY);
+	if (file < 0) return false;
+
+	struct stat status;
+	void* data = fstat(file, &status) == 0 && status.st_size > 0
+		             ? mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0)
+		             : MAP_FAILED;
+	::close(file);
+	if (data == MAP_FAILED) return false;
+
+	data_ = data;
+	size_ = static_cast<size_t>(status.st_size);
+#endif
+
+	// A file too short for a header keeps the zero magic and fails the checks.
+	mesh_header header = {};
+	if (size_ >= sizeof(header)) std::memcpy(&header, data_, sizeof(header));
+
+	// The offsets come from the file, each is checked against its size before any sum could wrap.
+	const uint64_t size = size_;
+	bool valid = header.magic == mesh_magic && header.version == mesh_version && header.vertex_size == sizeof(vertex)
+		&& header.vertex_offset % stream_alignment == 0 && header.index_offset % stream_alignment == 0
+		&& header.vertex_offset <= size && header.index_offset <= size
+		&& header.vertex_count <= (size - header.vertex_offset) / sizeof(vertex)
+		&& header.index_count <= (size - header.index_offset) / sizeof(uint32_t)
+		&& header.vertex_offset + static_cast<uint64_t>(header.vertex_count) * sizeof(vertex) <= header.index_offset;
+
+	const auto* bytes = static_cast<const char*>(data_);
+	const auto* indices = valid ? reinterpret_cast<const uint32_t*>(bytes + header.index_offset) : nullptr;
+
+	// Draws index the vertices without checks, so a file with any index out of range is rejected.
+	for (uint32_t i = 0; valid && i < header.index_count; ++i)
+	{
+		valid = indices[i] < header.vertex_count;
+	}
+
+	if (!valid)
+	{
+		close();
+		return false;
+	}
+
+	view_.vertices = reinterpret_cast<const vertex*>(bytes + header.vertex_offset);
+	view_.vertex_count = header.vertex_count;
+	view_.indices = indices;
+	view_.index_count = header.index_count;
+	view_.bounds.center = vec3(header.bounds[0], header.bounds[1], header.bounds[2]);
+	view_.bounds.radius = header.bounds[3];
+	return true;
+}
+
+void mapped_mesh::close()
+{
+	if (data_)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(data_);
+#else
+		munmap(data_, size_);
+#endif
+	}
+
+	data_ = nullptr;
+	size_ = 0;
+	view_ = mesh_view();
+}
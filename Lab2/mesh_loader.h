@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "engine_data.h"
+
+class base_object;
+
+// Reads mesh assets: Wavefront OBJ text, and a binary cache that is memory mapped and used in place.
+class mesh_loader
+{
+public:
+	// Parses the v, vt and f records of an OBJ file, other records are skipped. Polygons are fanned into
+	// triangles and each distinct position and texture coordinate pair becomes one vertex. Positions may carry
+	// an r g b color after them (0 to 1), otherwise vertices are opaque white.
+	static bool load_obj(const char* path, std::vector<vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// An object owning the geometry of an OBJ file, nullptr when it can't be read.
+	static std::unique_ptr<base_object> import_obj(const char* path, const mat_4& world_matrix = mat_4::identity());
+
+	// Writes the binary mesh format mapped_mesh reads.
+	static bool write_binary(const char* path, const vertex* vertices, uint32_t vertex_count, const uint32_t* indices,
+	                         uint32_t index_count);
+};
+
+// A binary mesh file mapped read only. The vertex and index streams are 64 byte aligned in the file, so the
+// view points straight into the mapping and draws without parsing or copying. Files written with a different
+// vertex layout, with streams outside the file or with an index past the vertices are rejected.
+class mapped_mesh
+{
+public:
+	mapped_mesh() = default;
+
+	~mapped_mesh();
+
+	mapped_mesh(const mapped_mesh& other) = delete;
+
+	mapped_mesh(mapped_mesh&& other) noexcept;
+
+	mapped_mesh& operator=(const mapped_mesh& other) = delete;
+
+	mapped_mesh& operator=(mapped_mesh&& other) noexcept;
+
+	// Maps path, closing whatever was open. False leaves it closed.
+	bool open(const char* path);
+
+	void close();
+
+	bool is_open() const { return data_ != nullptr; }
+
+	// Valid while the file stays open.
+	const mesh_view& get_view() const { return view_; }
+
+private:
+	void* data_ = nullptr;
+	size_t size_ = 0;
+	mesh_view view_;
+};
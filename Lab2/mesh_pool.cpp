@@ -0,0 +1,160 @@
+#include "mesh_pool.h"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "engine_data.h"
+
+mesh_pool::~mesh_pool()
+{
+	trim();
+}
+
+void* mesh_pool::allocate(const size_t bytes)
+{
+	const auto size_class = get_class(bytes);
+	const size_t block_size = size_class <= max_class_bits ? size_t{ 1 } << size_class : bytes;
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	++stats_.allocations;
+	++stats_.live_blocks;
+	stats_.live_bytes += block_size;
+	stats_.peak_bytes = std::max(stats_.peak_bytes, stats_.live_bytes);
+
+	if (size_class <= max_class_bits)
+	{
+		auto& free = free_[size_class - min_class_bits];
+		if (!free.empty())
+		{
+			void* block = free.back();
+			free.pop_back();
+			++stats_.reuses;
+			return block;
+		}
+	}
+
+	++stats_.heap_allocations;
+	lock.unlock();
+	return ::operator new(block_size);
+}
+
+void mesh_pool::release(void* block, const size_t bytes)
+{
+	if (!block) return;
+
+	const auto size_class = get_class(bytes);
+	const size_t block_size = size_class <= max_class_bits ? size_t{ 1 } << size_class : bytes;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	++stats_.releases;
+	--stats_.live_blocks;
+	stats_.live_bytes -= block_size;
+
+	if (size_class <= max_class_bits)
+		free_[size_class - min_class_bits].push_back(block);
+	else
+		::operator delete(block);
+}
+
+void mesh_pool::trim()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (auto& free : free_)
+	{
+		for (void* block : free) ::operator delete(block);
+		free.clear();
+	}
+}
+
+pool_stats mesh_pool::get_stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+mesh_pool& mesh_pool::get_default()
+{
+	static mesh_pool pool;
+	return pool;
+}
+
+uint32_t mesh_pool::get_class(const size_t bytes)
+{
+	uint32_t size_class = min_class_bits;
+	while (size_class <= max_class_bits && (size_t{ 1 } << size_class) < bytes) ++size_class;
+	return size_class;
+}
+
+mesh_storage::mesh_storage(const uint32_t vertex_count, const uint32_t index_count, mesh_pool& pool)
+	: pool_(&pool),
+	  vertex_count_(vertex_count),
+	  index_count_(index_count)
+{
+	static_assert(alignof(vertex) % alignof(uint32_t) == 0, "indices follow the vertices in the block");
+
+	void* block = pool.allocate(get_bytes());
+	vertices_ = static_cast<vertex*>(block);
+	indices_ = reinterpret_cast<uint32_t*>(vertices_ + vertex_count);
+
+	std::uninitialized_fill_n(vertices_, vertex_count, vertex());
+}
+
+mesh_storage::~mesh_storage()
+{
+	static_assert(std::is_trivially_destructible<vertex>::value, "vertices are released without destructors");
+
+	if (pool_) pool_->release(vertices_, get_bytes());
+}
+
+mesh_storage::mesh_storage(mesh_storage&& other) noexcept: pool_(other.pool_),
+                                                           vertices_(other.vertices_),
+                                                           indices_(other.indices_),
+                                                           vertex_count_(other.vertex_count_),
+                                                           index_count_(other.index_count_)
+{
+	other.pool_ = nullptr;
+	other.vertices_ = nullptr;
+	other.indices_ = nullptr;
+	other.vertex_count_ = 0;
+	other.index_count_ = 0;
+}
+
+mesh_storage& mesh_storage::operator=(mesh_storage&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	// The old block goes back to its pool now rather than living on in other.
+	if (pool_) pool_->release(vertices_, get_bytes());
+
+	pool_ = other.pool_;
+	vertices_ = other.vertices_;
+	indices_ = other.indices_;
+	vertex_count_ = other.vertex_count_;
+	index_count_ = other.index_count_;
+
+	other.pool_ = nullptr;
+	other.vertices_ = nullptr;
+	other.indices_ = nullptr;
+	other.vertex_count_ = 0;
+	other.index_count_ = 0;
+	return *this;
+}
+
+mesh_storage mesh_storage::clone() const
+{
+	if (!pool_) return mesh_storage();
+
+	mesh_storage copy(vertex_count_, index_count_, *pool_);
+	std::copy_n(vertices_, vertex_count_, copy.vertices_);
+	std::copy_n(indices_, index_count_, copy.indices_);
+	return copy;
+}
+
+size_t mesh_storage::get_bytes() const
+{
+	return static_cast<size_t>(vertex_count_) * sizeof(vertex) + static_cast<size_t>(index_count_) * sizeof(uint32_t);
+}
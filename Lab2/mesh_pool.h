@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct vertex;
+
+struct pool_stats
+{
+	// Blocks and bytes handed out and not yet released, bytes are the rounded up block sizes.
+	uint64_t live_blocks = 0;
+	uint64_t live_bytes = 0;
+	uint64_t peak_bytes = 0;
+
+	uint64_t allocations = 0;
+	uint64_t releases = 0;
+
+	// Allocations served from a released block instead of the heap.
+	uint64_t reuses = 0;
+	uint64_t heap_allocations = 0;
+};
+
+// Allocator for long lived geometry. Requests are rounded up to a power of two size class and released
+// blocks go on the free list of their class, so loading and unloading meshes recycles memory instead of
+// fragmenting the heap. Blocks above the largest class go straight to the heap. Thread safe.
+class mesh_pool
+{
+public:
+	static constexpr uint32_t min_class_bits = 8;
+	static constexpr uint32_t max_class_bits = 24;
+
+	mesh_pool() = default;
+
+	// Frees the cached blocks, every allocation has to be released by then.
+	~mesh_pool();
+
+	mesh_pool(const mesh_pool& other) = delete;
+
+	mesh_pool& operator=(const mesh_pool& other) = delete;
+
+	void* allocate(size_t bytes);
+
+	// bytes has to be the size the block was allocated with.
+	void release(void* block, size_t bytes);
+
+	// Returns the cached free blocks to the heap.
+	void trim();
+
+	pool_stats get_stats() const;
+
+	// Pool mesh_storage uses unless given another one.
+	static mesh_pool& get_default();
+
+private:
+	static uint32_t get_class(size_t bytes);
+
+	mutable std::mutex mutex_;
+	std::vector<void*> free_[max_class_bits - min_class_bits + 1];
+	pool_stats stats_;
+};
+
+// The vertex and index arrays of one mesh in a single pool block, returned to the pool when destroyed.
+// Move only, so exactly one owner ever frees it; clone makes an explicit deep copy.
+class mesh_storage
+{
+public:
+	mesh_storage() = default;
+
+	// Vertices are default constructed, indices are left uninitialized.
+	mesh_storage(uint32_t vertex_count, uint32_t index_count, mesh_pool& pool = mesh_pool::get_default());
+
+	~mesh_storage();
+
+	mesh_storage(const mesh_storage& other) = delete;
+
+	mesh_storage(mesh_storage&& other) noexcept;
+
+	mesh_storage& operator=(const mesh_storage& other) = delete;
+
+	mesh_storage& operator=(mesh_storage&& other) noexcept;
+
+	mesh_storage clone() const;
+
+	vertex* get_vertices() const { return vertices_; }
+
+	uint32_t get_vertex_count() const { return vertex_count_; }
+
+	uint32_t* get_indices() const { return indices_; }
+
+	uint32_t get_index_count() const { return index_count_; }
+
+private:
+	size_t get_bytes() const;
+
+	mesh_pool* pool_ = nullptr;
+	vertex* vertices_ = nullptr;
+	uint32_t* indices_ = nullptr;
+	uint32_t vertex_count_ = 0;
+	uint32_t index_count_ = 0;
+};
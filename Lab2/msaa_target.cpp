@@ -0,0 +1,124 @@
+#include "msaa_target.h"
+
+#include <algorithm>
+
+msaa_target::msaa_target(const uint32_t width, const uint32_t height, const uint32_t sample_count,
+                         const uint32_t tile_size): width(width),
+	height(height),
+	pattern_(sample_pattern::get(sample_count)),
+	full_mask_((1u << pattern_.count) - 1),
+	tiles_x_((width + tile_size - 1) / tile_size),
+	colors_(new uint32_t[static_cast<size_t>(width) * height]()),
+	slots_(new uint32_t[static_cast<size_t>(width) * height]),
+	pools_(static_cast<size_t>(tiles_x_) * ((height + tile_size - 1) / tile_size))
+{
+	while ((1u << tile_shift_) < tile_size) ++tile_shift_;
+	std::fill_n(slots_.get(), static_cast<size_t>(width) * height, compressed);
+}
+
+void msaa_target::clear(const screen_rect& rect, const uint32_t color)
+{
+	const auto& kernels = pixel_kernels::get();
+	for (auto y = static_cast<uint32_t>(rect.min_y); y < static_cast<uint32_t>(rect.max_y); ++y)
+	{
+		const size_t row = static_cast<size_t>(y) * width;
+		for (auto x = static_cast<uint32_t>(rect.min_x); x < static_cast<uint32_t>(rect.max_x); ++x)
+		{
+			if (slots_[row + x] != compressed) pools_[get_tile(x, y)].free.push_back(slots_[row + x]);
+		}
+		kernels.fill(colors_.get() + row + rect.min_x, color, static_cast<size_t>(rect.max_x - rect.min_x));
+		kernels.fill(slots_.get() + row + rect.min_x, compressed, static_cast<size_t>(rect.max_x - rect.min_x));
+	}
+
+	// Pools of tiles cleared whole start over.
+	const uint32_t tile_size = 1u << tile_shift_;
+	for (uint32_t ty = (rect.min_y + tile_size - 1) >> tile_shift_; ty < pools_.size() / tiles_x_; ++ty)
+	{
+		const uint32_t y = ty << tile_shift_;
+		if (std::min(y + tile_size, height) > static_cast<uint32_t>(rect.max_y)) break;
+
+		for (uint32_t tx = (rect.min_x + tile_size - 1) >> tile_shift_; tx < tiles_x_; ++tx)
+		{
+			const uint32_t x = tx << tile_shift_;
+			if (std::min(x + tile_size, width) > static_cast<uint32_t>(rect.max_x)) break;
+
+			pools_[ty * tiles_x_ + tx].samples.clear();
+			pools_[ty * tiles_x_ + tx].free.clear();
+		}
+	}
+}
+
+uint32_t* msaa_target::expand(const uint32_t x, const uint32_t y, const size_t pixel)
+{
+	auto& pool = pools_[get_tile(x, y)];
+
+	uint32_t slot;
+	if (!pool.free.empty())
+	{
+		slot = pool.free.back();
+		pool.free.pop_back();
+	}
+	else
+	{
+		slot = static_cast<uint32_t>(pool.samples.size());
+		pool.samples.resize(pool.samples.size() + pattern_.count);
+	}
+
+	slots_[pixel] = slot;
+	uint32_t* samples = pool.samples.data() + slot;
+	std::fill_n(samples, pattern_.count, colors_[pixel]);
+	return samples;
+}
+
+uint32_t msaa_target::get_pixel(const uint32_t x, const uint32_t y) const
+{
+	const size_t pixel = static_cast<size_t>(y) * width + x;
+	if (slots_[pixel] == compressed) return colors_[pixel];
+
+	uint32_t result;
+	pixel_kernels::get().resolve(&result, pools_[get_tile(x, y)].samples.data() + slots_[pixel], pattern_.count, 1);
+	return result;
+}
+
+uint32_t msaa_target::get_expanded_count(const screen_rect& rect) const
+{
+	uint32_t count = 0;
+	for (int32_t y = rect.min_y; y < rect.max_y; ++y)
+		for (int32_t x = rect.min_x; x < rect.max_x; ++x)
+			count += slots_[static_cast<size_t>(y) * width + x] != compressed;
+	return count;
+}
+
+void msaa_target::resolve(const screen_rect& rect, uint32_t* pixels, const uint32_t stride) const
+{
+	const auto& kernels = pixel_kernels::get();
+	const uint32_t count = pattern_.count;
+
+	for (auto y = static_cast<uint32_t>(rect.min_y); y < static_cast<uint32_t>(rect.max_y); ++y)
+	{
+		const uint32_t* colors = colors_.get() + static_cast<size_t>(y) * width;
+		const uint32_t* slots = slots_.get() + static_cast<size_t>(y) * width;
+		uint32_t* line = pixels + static_cast<size_t>(y) * stride;
+
+		// Runs of compressed pixels are copied, runs of expanded ones whose samples follow each other in one pool,
+		// as pixels expanded left to right along an edge do, are averaged in one call.
+		auto x = static_cast<uint32_t>(rect.min_x);
+		while (x < static_cast<uint32_t>(rect.max_x))
+		{
+			const uint32_t start = x;
+			if (slots[x] == compressed)
+			{
+				while (x < static_cast<uint32_t>(rect.max_x) && slots[x] == compressed) ++x;
+				kernels.copy(line + start, colors + start, x - start);
+				continue;
+			}
+
+			const uint32_t first = slots[x];
+			const uint32_t tile = get_tile(x, y);
+			while (x < static_cast<uint32_t>(rect.max_x) && slots[x] == first + (x - start) * count &&
+				get_tile(x, y) == tile)
+				++x;
+			kernels.resolve(line + start, pools_[tile].samples.data() + first, count, x - start);
+		}
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "pixel_kernels.h"
+#include "rasterizer.h"
+
+// Color samples of a multisampled frame, compressed per pixel. A pixel whose draws all covered it whole keeps one
+// color, only pixels on an edge store a color per sample. Those come from a pool of the pixel's screen tile, so
+// tiles can be drawn on separate threads, and return to it once the pixel is uniform again. resolve averages
+// the samples into the single sampled frame.
+class msaa_target
+{
+public:
+	// sample_count is 2, 4 or 8, tile_size a power of two.
+	msaa_target(uint32_t width, uint32_t height, uint32_t sample_count, uint32_t tile_size);
+
+	msaa_target(const msaa_target& other) = delete;
+
+	msaa_target& operator=(const msaa_target& other) = delete;
+
+	const uint32_t width;
+	const uint32_t height;
+
+	uint32_t get_sample_count() const { return pattern_.count; }
+
+	const sample_pattern& get_pattern() const { return pattern_; }
+
+	// Mask with every sample set.
+	uint32_t get_full_mask() const { return full_mask_; }
+
+	// Sets every pixel of rect to color and compresses it.
+	void clear(const screen_rect& rect, uint32_t color);
+
+	// Writes color to the samples of mask by Mode. Replacing every sample, or leaving them all equal, compresses
+	// the pixel.
+	template <blend_mode Mode>
+	void write(const uint32_t x, const uint32_t y, const uint32_t mask, const uint32_t color)
+	{
+		const size_t pixel = static_cast<size_t>(y) * width + x;
+		const uint32_t slot = slots_[pixel];
+
+		uint32_t* samples;
+		if (slot == compressed)
+		{
+			if (mask == full_mask_)
+			{
+				colors_[pixel] = pixel_kernels::apply<Mode>(colors_[pixel], color);
+				return;
+			}
+			samples = expand(x, y, pixel);
+		}
+		else
+		{
+			if (mask == full_mask_ && Mode == blend_mode::replace)
+			{
+				compress(x, y, pixel, color);
+				return;
+			}
+			samples = pools_[get_tile(x, y)].samples.data() + slot;
+		}
+
+		for (uint32_t s = 0; s < pattern_.count; ++s)
+		{
+			if (mask >> s & 1) samples[s] = pixel_kernels::apply<Mode>(samples[s], color);
+		}
+
+		// Neighbouring triangles of one color fill the pixel back to a single color.
+		for (uint32_t s = 1; s < pattern_.count; ++s)
+		{
+			if (samples[s] != samples[0]) return;
+		}
+		compress(x, y, pixel, samples[0]);
+	}
+
+	// Average of the samples of a pixel.
+	uint32_t get_pixel(uint32_t x, uint32_t y) const;
+
+	bool is_compressed(const uint32_t x, const uint32_t y) const
+	{
+		return slots_[static_cast<size_t>(y) * width + x] == compressed;
+	}
+
+	// Pixels of rect storing a color per sample.
+	uint32_t get_expanded_count(const screen_rect& rect) const;
+
+	// Writes the average samples of every pixel of rect to the same pixels of a single sampled frame.
+	void resolve(const screen_rect& rect, uint32_t* pixels, uint32_t stride) const;
+
+private:
+	static constexpr uint32_t compressed = UINT32_MAX;
+
+	// Samples of the expanded pixels of one tile, sample_count per pixel, and the starts of released ones.
+	struct sample_pool
+	{
+		std::vector<uint32_t> samples;
+		std::vector<uint32_t> free;
+	};
+
+	uint32_t get_tile(const uint32_t x, const uint32_t y) const
+	{
+		return (y >> tile_shift_) * tiles_x_ + (x >> tile_shift_);
+	}
+
+	// Gives a compressed pixel samples holding its color.
+	uint32_t* expand(uint32_t x, uint32_t y, size_t pixel);
+
+	void compress(const uint32_t x, const uint32_t y, const size_t pixel, const uint32_t color)
+	{
+		pools_[get_tile(x, y)].free.push_back(slots_[pixel]);
+		slots_[pixel] = compressed;
+		colors_[pixel] = color;
+	}
+
+	const sample_pattern& pattern_;
+	const uint32_t full_mask_;
+	uint32_t tile_shift_ = 0;
+	const uint32_t tiles_x_;
+
+	// Color of compressed pixels, and where the samples of the others start in their tile's pool.
+	std::unique_ptr<uint32_t[]> colors_;
+	std::unique_ptr<uint32_t[]> slots_;
+	std::vector<sample_pool> pools_;
+};
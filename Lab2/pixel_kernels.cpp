@@ -0,0 +1,516 @@
+#include "pixel_kernels.h"
+
+#include <cstring>
+
+#include "cpu_features.h"
+
+#ifdef LAB2_SSE2
+#include <immintrin.h>
+#endif
+
+// Spans at least this long bypass the cache when filled, a full frame clear would only evict it.
+static constexpr size_t stream_threshold = 1 << 18;
+
+#pragma region scalar
+
+static void fill_scalar(uint32_t* dst, const uint32_t color, const size_t count)
+{
+	for (size_t i = 0; i < count; ++i) dst[i] = color;
+}
+
+static void copy_scalar(uint32_t* dst, const uint32_t* src, const size_t count)
+{
+	std::memcpy(dst, src, count * sizeof(uint32_t));
+}
+
+static void blend_fill_scalar(uint32_t* dst, const uint32_t color, const size_t count)
+{
+	for (size_t i = 0; i < count; ++i) dst[i] = pixel_kernels::blend_pixel(dst[i], color);
+}
+
+static void blend_scalar(uint32_t* dst, const uint32_t* src, const size_t count)
+{
+	for (size_t i = 0; i < count; ++i) dst[i] = pixel_kernels::blend_pixel(dst[i], src[i]);
+}
+
+// Composites count pixels, src advancing by Step so a fill reads one color.
+template <blend_mode Mode, size_t Step>
+static void composite_run_scalar(uint32_t* dst, const uint32_t* src, const size_t count)
+{
+	for (size_t i = 0; i < count; ++i) dst[i] = pixel_kernels::composite_pixel<Mode>(dst[i], src[i * Step]);
+}
+
+template <size_t Step>
+static void composite_modes_scalar(uint32_t* dst, const uint32_t* src, const size_t count, const blend_mode mode)
+{
+	switch (mode)
+	{
+	case blend_mode::add: return composite_run_scalar<blend_mode::add, Step>(dst, src, count);
+	case blend_mode::multiply: return composite_run_scalar<blend_mode::multiply, Step>(dst, src, count);
+	case blend_mode::screen: return composite_run_scalar<blend_mode::screen, Step>(dst, src, count);
+	default: return composite_run_scalar<blend_mode::over, Step>(dst, src, count);
+	}
+}
+
+static void composite_scalar(uint32_t* dst, const uint32_t* src, const size_t count, const blend_mode mode)
+{
+	composite_modes_scalar<1>(dst, src, count, mode);
+}
+
+static void composite_fill_scalar(uint32_t* dst, const uint32_t color, const size_t count, const blend_mode mode)
+{
+	composite_modes_scalar<0>(dst, &color, count, mode);
+}
+
+static void resolve_scalar(uint32_t* dst, const uint32_t* samples, const uint32_t sample_count, const size_t count)
+{
+	const uint32_t shift = sample_count == 8 ? 3 : sample_count == 4 ? 2 : 1;
+	for (size_t i = 0; i < count; ++i, samples += sample_count)
+	{
+		// Red and blue, then alpha and green, in separate 16 bit lanes, 8 samples of 255 still fit.
+		uint32_t rb = 0;
+		uint32_t ag = 0;
+		for (uint32_t s = 0; s < sample_count; ++s)
+		{
+			rb += samples[s] & 0x00FF00FF;
+			ag += samples[s] >> 8 & 0x00FF00FF;
+		}
+		const uint32_t round = (sample_count / 2) * 0x00010001;
+		dst[i] = ((rb + round) >> shift & 0x00FF00FF) | ((ag + round) >> shift & 0x00FF00FF) << 8;
+	}
+}
+
+#pragma endregion
+
+#ifdef LAB2_SSE2
+
+#pragma region sse2
+
+static void fill_sse2(uint32_t* dst, const uint32_t color, const size_t count)
+{
+	size_t i = 0;
+
+	// Align the destination so large spans can use streaming stores.
+	for (; i < count && (reinterpret_cast<uintptr_t>(dst + i) & 15); ++i) dst[i] = color;
+
+	const __m128i c = _mm_set1_epi32(static_cast<int>(color));
+	if (count - i >= stream_threshold)
+	{
+		for (; i + 16 <= count; i += 16)
+		{
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), c);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 4), c);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 8), c);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 12), c);
+		}
+		_mm_sfence();
+	}
+
+	for (; i + 4 <= count; i += 4) _mm_store_si128(reinterpret_cast<__m128i*>(dst + i), c);
+	for (; i < count; ++i) dst[i] = color;
+}
+
+static void copy_sse2(uint32_t* dst, const uint32_t* src, const size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+	}
+	for (; i < count; ++i) dst[i] = src[i];
+}
+
+// Exact division by 255 of eight 16 bit lanes holding at most 255 * 255.
+static __m128i div_255_sse2(const __m128i x)
+{
+	const __m128i t = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Blends two pixels held as 16 bit lanes, src already premultiplied by its alpha.
+static __m128i blend_lanes_sse2(const __m128i dst, const __m128i src_times_alpha, const __m128i inverse_alpha)
+{
+	return div_255_sse2(_mm_add_epi16(_mm_mullo_epi16(dst, inverse_alpha), src_times_alpha));
+}
+
+static void blend_fill_sse2(uint32_t* dst, const uint32_t color, const size_t count)
+{
+	const uint32_t a = color >> 24;
+	const __m128i zero = _mm_setzero_si128();
+
+	// The alpha lane blends towards 255 so coverage accumulates.
+	const __m128i src = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color | 0xFF000000)), zero);
+	const __m128i src_times_alpha = _mm_mullo_epi16(src, _mm_set1_epi16(static_cast<short>(a)));
+	const __m128i inverse_alpha = _mm_set1_epi16(static_cast<short>(255 - a));
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+		const __m128i lo = blend_lanes_sse2(_mm_unpacklo_epi8(d, zero), src_times_alpha, inverse_alpha);
+		const __m128i hi = blend_lanes_sse2(_mm_unpackhi_epi8(d, zero), src_times_alpha, inverse_alpha);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+	}
+	for (; i < count; ++i) dst[i] = pixel_kernels::blend_pixel(dst[i], color);
+}
+
+// Blends two source pixels held as 16 bit lanes over two destination pixels.
+static __m128i blend_pair_sse2(const __m128i dst, const __m128i src)
+{
+	const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	const __m128i opaque_alpha = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+	const __m128i inverse_alpha = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+
+	return blend_lanes_sse2(dst, _mm_mullo_epi16(_mm_or_si128(src, opaque_alpha), alpha), inverse_alpha);
+}
+
+static void blend_sse2(uint32_t* dst, const uint32_t* src, const size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+		const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		const __m128i lo = blend_pair_sse2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+		const __m128i hi = blend_pair_sse2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+	}
+	for (; i < count; ++i) dst[i] = pixel_kernels::blend_pixel(dst[i], src[i]);
+}
+
+// Composites two premultiplied source pixels held as 16 bit lanes with two destination pixels, lanes above 255
+// saturate when packed.
+template <blend_mode Mode>
+static __m128i composite_pair_sse2(const __m128i dst, const __m128i src)
+{
+	const __m128i full = _mm_set1_epi16(255);
+	const __m128i inverse_sa = _mm_sub_epi16(full, _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)),
+	                                                                   _MM_SHUFFLE(3, 3, 3, 3)));
+	if (Mode == blend_mode::over) return _mm_add_epi16(src, div_255_sse2(_mm_mullo_epi16(dst, inverse_sa)));
+
+	const __m128i product = div_255_sse2(_mm_mullo_epi16(src, dst));
+	if (Mode == blend_mode::screen) return _mm_sub_epi16(_mm_add_epi16(src, dst), product);
+
+	const __m128i inverse_da = _mm_sub_epi16(full, _mm_shufflehi_epi16(_mm_shufflelo_epi16(dst, _MM_SHUFFLE(3, 3, 3, 3)),
+	                                                                   _MM_SHUFFLE(3, 3, 3, 3)));
+	return _mm_add_epi16(_mm_add_epi16(product, div_255_sse2(_mm_mullo_epi16(src, inverse_da))),
+	                     div_255_sse2(_mm_mullo_epi16(dst, inverse_sa)));
+}
+
+template <blend_mode Mode, size_t Step>
+static void composite_run_sse2(uint32_t* dst, const uint32_t* src, const size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i color = _mm_set1_epi32(Step ? 0 : static_cast<int>(src[0]));
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+		const __m128i s = Step ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)) : color;
+
+		// Adding needs no wider lanes, bytes saturate by themselves.
+		__m128i result;
+		if (Mode == blend_mode::add) result = _mm_adds_epu8(d, s);
+		else
+		{
+			result = _mm_packus_epi16(composite_pair_sse2<Mode>(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero)),
+			                          composite_pair_sse2<Mode>(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero)));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), result);
+	}
+	composite_run_scalar<Mode, Step>(dst + i, src + i * Step, count - i);
+}
+
+template <size_t Step>
+static void composite_modes_sse2(uint32_t* dst, const uint32_t* src, const size_t count, const blend_mode mode)
+{
+	switch (mode)
+	{
+	case blend_mode::add: return composite_run_sse2<blend_mode::add, Step>(dst, src, count);
+	case blend_mode::multiply: return composite_run_sse2<blend_mode::multiply, Step>(dst, src, count);
+	case blend_mode::screen: return composite_run_sse2<blend_mode::screen, Step>(dst, src, count);
+	default: return composite_run_sse2<blend_mode::over, Step>(dst, src, count);
+	}
+}
+
+static void composite_sse2(uint32_t* dst, const uint32_t* src, const size_t count, const blend_mode mode)
+{
+	composite_modes_sse2<1>(dst, src, count, mode);
+}
+
+static void composite_fill_sse2(uint32_t* dst, const uint32_t color, const size_t count, const blend_mode mode)
+{
+	composite_modes_sse2<0>(dst, &color, count, mode);
+}
+
+// Sums the channels of four pixels into the low four 16 bit lanes, the high four hold junk.
+static __m128i sum_four_sse2(const __m128i pixels)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i pairs = _mm_add_epi16(_mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero));
+	return _mm_add_epi16(pairs, _mm_srli_si128(pairs, 8));
+}
+
+static void resolve_sse2(uint32_t* dst, const uint32_t* samples, const uint32_t sample_count, const size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(static_cast<short>(sample_count / 2));
+	const __m128i shift = _mm_cvtsi32_si128(sample_count == 8 ? 3 : sample_count == 4 ? 2 : 1);
+
+	for (size_t i = 0; i < count; ++i, samples += sample_count)
+	{
+		__m128i sum;
+		if (sample_count == 8)
+		{
+			sum = _mm_add_epi16(sum_four_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples))),
+			                    sum_four_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + 4))));
+		}
+		else if (sample_count == 4)
+		{
+			sum = sum_four_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples)));
+		}
+		else
+		{
+			const __m128i pair = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples)), zero);
+			sum = _mm_add_epi16(pair, _mm_srli_si128(pair, 8));
+		}
+
+		const __m128i average = _mm_srl_epi16(_mm_add_epi16(sum, round), shift);
+		dst[i] = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(average, zero)));
+	}
+}
+
+#pragma endregion
+
+#pragma region avx2
+
+LAB2_TARGET_AVX2 static void fill_avx2(uint32_t* dst, const uint32_t color, const size_t count)
+{
+	size_t i = 0;
+	for (; i < count && (reinterpret_cast<uintptr_t>(dst + i) & 31); ++i) dst[i] = color;
+
+	const __m256i c = _mm256_set1_epi32(static_cast<int>(color));
+	if (count - i >= stream_threshold)
+	{
+		for (; i + 16 <= count; i += 16)
+		{
+			_mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), c);
+			_mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i + 8), c);
+		}
+		_mm_sfence();
+	}
+
+	for (; i + 16 <= count; i += 16)
+	{
+		_mm256_store_si256(reinterpret_cast<__m256i*>(dst + i), c);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(dst + i + 8), c);
+	}
+	for (; i + 8 <= count; i += 8) _mm256_store_si256(reinterpret_cast<__m256i*>(dst + i), c);
+	for (; i < count; ++i) dst[i] = color;
+}
+
+LAB2_TARGET_AVX2 static void copy_avx2(uint32_t* dst, const uint32_t* src, const size_t count)
+{
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+		const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 8));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), a);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 8), b);
+	}
+	for (; i < count; ++i) dst[i] = src[i];
+}
+
+LAB2_TARGET_AVX2 static __m256i div_255_avx2(const __m256i x)
+{
+	const __m256i t = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+LAB2_TARGET_AVX2 static void blend_fill_avx2(uint32_t* dst, const uint32_t color, const size_t count)
+{
+	const uint32_t a = color >> 24;
+	const __m256i zero = _mm256_setzero_si256();
+
+	const __m256i src = _mm256_unpacklo_epi8(_mm256_set1_epi32(static_cast<int>(color | 0xFF000000)), zero);
+	const __m256i src_times_alpha = _mm256_mullo_epi16(src, _mm256_set1_epi16(static_cast<short>(a)));
+	const __m256i inverse_alpha = _mm256_set1_epi16(static_cast<short>(255 - a));
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+		const __m256i lo = div_255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inverse_alpha), src_times_alpha));
+		const __m256i hi = div_255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inverse_alpha), src_times_alpha));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+	}
+	blend_fill_sse2(dst + i, color, count - i);
+}
+
+LAB2_TARGET_AVX2 static __m256i blend_pair_avx2(const __m256i dst, const __m256i src)
+{
+	const __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	const __m256i opaque_alpha = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0);
+	const __m256i inverse_alpha = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+
+	return div_255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(dst, inverse_alpha),
+	                                     _mm256_mullo_epi16(_mm256_or_si256(src, opaque_alpha), alpha)));
+}
+
+LAB2_TARGET_AVX2 static void blend_avx2(uint32_t* dst, const uint32_t* src, const size_t count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+		const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+		const __m256i lo = blend_pair_avx2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero));
+		const __m256i hi = blend_pair_avx2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+	}
+	blend_sse2(dst + i, src + i, count - i);
+}
+
+LAB2_TARGET_AVX2 static __m256i broadcast_alpha_avx2(const __m256i pixels)
+{
+	return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+template <blend_mode Mode>
+LAB2_TARGET_AVX2 static __m256i composite_quad_avx2(const __m256i dst, const __m256i src)
+{
+	const __m256i full = _mm256_set1_epi16(255);
+	const __m256i inverse_sa = _mm256_sub_epi16(full, broadcast_alpha_avx2(src));
+	if (Mode == blend_mode::over) return _mm256_add_epi16(src, div_255_avx2(_mm256_mullo_epi16(dst, inverse_sa)));
+
+	const __m256i product = div_255_avx2(_mm256_mullo_epi16(src, dst));
+	if (Mode == blend_mode::screen) return _mm256_sub_epi16(_mm256_add_epi16(src, dst), product);
+
+	const __m256i inverse_da = _mm256_sub_epi16(full, broadcast_alpha_avx2(dst));
+	return _mm256_add_epi16(_mm256_add_epi16(product, div_255_avx2(_mm256_mullo_epi16(src, inverse_da))),
+	                        div_255_avx2(_mm256_mullo_epi16(dst, inverse_sa)));
+}
+
+template <blend_mode Mode, size_t Step>
+LAB2_TARGET_AVX2 static void composite_run_avx2(uint32_t* dst, const uint32_t* src, const size_t count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i color = _mm256_set1_epi32(Step ? 0 : static_cast<int>(src[0]));
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+		const __m256i s = Step ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)) : color;
+
+		__m256i result;
+		if (Mode == blend_mode::add) result = _mm256_adds_epu8(d, s);
+		else
+		{
+			result = _mm256_packus_epi16(
+				composite_quad_avx2<Mode>(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero)),
+				composite_quad_avx2<Mode>(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero)));
+		}
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), result);
+	}
+	composite_run_sse2<Mode, Step>(dst + i, src + i * Step, count - i);
+}
+
+template <size_t Step>
+LAB2_TARGET_AVX2 static void composite_modes_avx2(uint32_t* dst, const uint32_t* src, const size_t count,
+                                                  const blend_mode mode)
+{
+	switch (mode)
+	{
+	case blend_mode::add: return composite_run_avx2<blend_mode::add, Step>(dst, src, count);
+	case blend_mode::multiply: return composite_run_avx2<blend_mode::multiply, Step>(dst, src, count);
+	case blend_mode::screen: return composite_run_avx2<blend_mode::screen, Step>(dst, src, count);
+	default: return composite_run_avx2<blend_mode::over, Step>(dst, src, count);
+	}
+}
+
+LAB2_TARGET_AVX2 static void composite_avx2(uint32_t* dst, const uint32_t* src, const size_t count,
+                                            const blend_mode mode)
+{
+	composite_modes_avx2<1>(dst, src, count, mode);
+}
+
+LAB2_TARGET_AVX2 static void composite_fill_avx2(uint32_t* dst, const uint32_t color, const size_t count,
+                                                 const blend_mode mode)
+{
+	composite_modes_avx2<0>(dst, &color, count, mode);
+}
+
+// Four samples of two pixels per register, one pixel per 128 bit lane.
+LAB2_TARGET_AVX2 static void resolve_avx2(uint32_t* dst, const uint32_t* samples, const uint32_t sample_count,
+                                          const size_t count)
+{
+	if (sample_count != 4)
+	{
+		resolve_sse2(dst, samples, sample_count, count);
+		return;
+	}
+
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i round = _mm256_set1_epi16(2);
+
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2, samples += 8)
+	{
+		const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples));
+		const __m256i pairs = _mm256_add_epi16(_mm256_unpacklo_epi8(s, zero), _mm256_unpackhi_epi8(s, zero));
+		const __m256i sum = _mm256_add_epi16(pairs, _mm256_srli_si256(pairs, 8));
+		const __m256i packed = _mm256_packus_epi16(_mm256_srli_epi16(_mm256_add_epi16(sum, round), 2), zero);
+
+		dst[i] = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm256_castsi256_si128(packed)));
+		dst[i + 1] = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1)));
+	}
+	resolve_sse2(dst + i, samples, sample_count, count - i);
+}
+
+#pragma endregion
+
+#endif
+
+const pixel_kernels& pixel_kernels::scalar()
+{
+	static const pixel_kernels kernels{
+		"scalar", fill_scalar, copy_scalar, blend_fill_scalar, blend_scalar, composite_scalar, composite_fill_scalar,
+		resolve_scalar
+	};
+	return kernels;
+}
+
+const pixel_kernels* pixel_kernels::sse2()
+{
+#ifdef LAB2_SSE2
+	static const pixel_kernels kernels{
+		"sse2", fill_sse2, copy_sse2, blend_fill_sse2, blend_sse2, composite_sse2, composite_fill_sse2, resolve_sse2
+	};
+	if (cpu_features::get().sse2) return &kernels;
+#endif
+	return nullptr;
+}
+
+const pixel_kernels* pixel_kernels::avx2()
+{
+#ifdef LAB2_SSE2
+	static const pixel_kernels kernels{
+		"avx2", fill_avx2, copy_avx2, blend_fill_avx2, blend_avx2, composite_avx2, composite_fill_avx2, resolve_avx2
+	};
+	if (cpu_features::get().avx2) return &kernels;
+#endif
+	return nullptr;
+}
+
+const pixel_kernels& pixel_kernels::get()
+{
+	static const pixel_kernels& kernels = avx2() ? *avx2() : sse2() ? *sse2() : scalar();
+	return kernels;
+}
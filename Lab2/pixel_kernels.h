@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// How a shaded color is combined with the target. The last four premultiply the color by its alpha and take
+// the target as premultiplied, which an opaque target already is.
+enum class blend_mode
+{
+	// The shaded color replaces the target.
+	replace,
+	// Straight alpha over the target.
+	alpha,
+	// Premultiplied source over.
+	over,
+	// Sum of both, saturating.
+	add,
+	// Product of both, each shown unchanged where the other is transparent.
+	multiply,
+	// Inverse of the product of the inverses, brightens.
+	screen
+};
+
+// Span kernels over 32 bit ARGB pixels. The best set the cpu supports is picked at runtime,
+// every set produces exactly the same pixels as the scalar one.
+struct pixel_kernels
+{
+	const char* name;
+
+	// Sets count pixels to color.
+	void (*fill)(uint32_t* dst, uint32_t color, size_t count);
+
+	void (*copy)(uint32_t* dst, const uint32_t* src, size_t count);
+
+	// Blends one color over count pixels by its alpha.
+	void (*blend_fill)(uint32_t* dst, uint32_t color, size_t count);
+
+	// Blends each source pixel over its destination by the source alpha.
+	void (*blend)(uint32_t* dst, const uint32_t* src, size_t count);
+
+	// Combines premultiplied source pixels with their destinations, mode is over, add, multiply or screen.
+	void (*composite)(uint32_t* dst, const uint32_t* src, size_t count, blend_mode mode);
+
+	// Combines one premultiplied color with count pixels, mode is over, add, multiply or screen.
+	void (*composite_fill)(uint32_t* dst, uint32_t color, size_t count, blend_mode mode);
+
+	// Averages each sample_count consecutive samples into one pixel, rounding to nearest. sample_count is 2, 4 or 8.
+	void (*resolve)(uint32_t* dst, const uint32_t* samples, uint32_t sample_count, size_t count);
+
+	// Fastest set supported by this cpu.
+	static const pixel_kernels& get();
+
+	static const pixel_kernels& scalar();
+
+	// nullptr when the cpu or the build lacks the instruction set.
+	static const pixel_kernels* sse2();
+
+	static const pixel_kernels* avx2();
+
+	// Exact x / 255 for x in [0, 255 * 255].
+	static uint32_t div_255(const uint32_t x)
+	{
+		const uint32_t t = x + 128;
+		return (t + (t >> 8)) >> 8;
+	}
+
+	// Straight alpha source over, dst = src * a + dst * (1 - a) and alpha accumulates.
+	static uint32_t blend_pixel(const uint32_t dst, const uint32_t src)
+	{
+		const uint32_t a = src >> 24;
+		const uint32_t ia = 255 - a;
+
+		// Red and blue, then alpha and green, share one multiply in separate 16 bit lanes.
+		uint32_t rb = (src & 0x00FF00FF) * a + (dst & 0x00FF00FF) * ia + 0x00800080;
+		rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+
+		uint32_t ag = ((src >> 8 & 0x000000FF) | 0x00FF0000) * a + (dst >> 8 & 0x00FF00FF) * ia + 0x00800080;
+		ag = (ag + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+
+		return ag | rb;
+	}
+
+	// Multiplies the color channels by alpha, which stays.
+	static uint32_t premultiply(const uint32_t color)
+	{
+		const uint32_t a = color >> 24;
+
+		uint32_t rb = (color & 0x00FF00FF) * a + 0x00800080;
+		rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+
+		uint32_t ag = ((color >> 8 & 0x000000FF) | 0x00FF0000) * a + 0x00800080;
+		ag = (ag + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+
+		return ag | rb;
+	}
+
+	// One channel of a premultiplied composite, sa and da the source and destination alpha.
+	template <blend_mode Mode>
+	static uint32_t composite_channel(const uint32_t s, const uint32_t d, const uint32_t sa, const uint32_t da)
+	{
+		uint32_t c;
+		if (Mode == blend_mode::add) c = s + d;
+		else if (Mode == blend_mode::multiply) c = div_255(s * d) + div_255(s * (255 - da)) + div_255(d * (255 - sa));
+		else if (Mode == blend_mode::screen) c = s + d - div_255(s * d);
+		else c = s + div_255(d * (255 - sa));
+		return c < 255 ? c : 255;
+	}
+
+	// Premultiplied src combined with dst by one of over, add, multiply or screen, every channel saturating.
+	template <blend_mode Mode>
+	static uint32_t composite_pixel(const uint32_t dst, const uint32_t src)
+	{
+		const uint32_t sa = src >> 24, da = dst >> 24;
+		uint32_t result = 0;
+		for (uint32_t shift = 0; shift < 32; shift += 8)
+		{
+			result |= composite_channel<Mode>(src >> shift & 0xFF, dst >> shift & 0xFF, sa, da) << shift;
+		}
+		return result;
+	}
+
+	// A shaded straight alpha color written to dst by any mode.
+	template <blend_mode Mode>
+	static uint32_t apply(const uint32_t dst, const uint32_t color)
+	{
+		switch (Mode)
+		{
+		case blend_mode::replace: return color;
+		case blend_mode::alpha: return blend_pixel(dst, color);
+		default: return composite_pixel<Mode>(dst, premultiply(color));
+		}
+	}
+};
@@ -0,0 +1,261 @@
+#include "pixel_pipeline.h"
+
+#include <algorithm>
+
+#include "msaa_target.h"
+#include "pixel_kernels.h"
+
+static uint32_t to_channel(const float value)
+{
+	return static_cast<uint32_t>(std::min(std::max(value, 0.0f), 255.0f) + 0.5f);
+}
+
+struct flat_shader
+{
+	static constexpr uint32_t attributes = attribute_none;
+
+	static uint32_t shade(const triangle_setup& triangle, const pixel_inputs&, const pixel_resources&)
+	{
+		return triangle.color;
+	}
+};
+
+struct vertex_color_shader
+{
+	static constexpr uint32_t attributes = attribute_color;
+
+	static uint32_t shade(const triangle_setup&, const pixel_inputs& in, const pixel_resources&)
+	{
+		return to_channel(in.a) << 24 | to_channel(in.r) << 16 | to_channel(in.g) << 8 | to_channel(in.b);
+	}
+};
+
+struct uv_shader
+{
+	static constexpr uint32_t attributes = attribute_uv;
+
+	static uint32_t shade(const triangle_setup&, const pixel_inputs& in, const pixel_resources&)
+	{
+		return 0xFF000000 | to_channel(in.u * 255) << 16 | to_channel(in.v * 255) << 8;
+	}
+};
+
+template <texture_filter Filter>
+struct texture_shader
+{
+	static constexpr uint32_t attributes = attribute_uv | attribute_uv_derivatives;
+
+	static uint32_t shade(const triangle_setup&, const pixel_inputs& in, const pixel_resources& resources)
+	{
+		const auto& image = *resources.image;
+		const float lod = image.get_lod(in.du_dx, in.dv_dx, in.du_dy, in.dv_dy);
+		return image.sample(in.u, in.v, lod, Filter);
+	}
+};
+
+// Perspective corrected attributes the shader asks for at pixel (x, y).
+template <typename Shader>
+static pixel_inputs interpolate(const triangle_attributes& attributes, const float fx, const float fy)
+{
+	pixel_inputs in{};
+	if (Shader::attributes == attribute_none) return in;
+
+	const float w = 1.0f / attributes.inv_w.at(fx, fy);
+
+	if (Shader::attributes & attribute_color)
+	{
+		in.a = attributes.color[0].at(fx, fy) * w;
+		in.r = attributes.color[1].at(fx, fy) * w;
+		in.g = attributes.color[2].at(fx, fy) * w;
+		in.b = attributes.color[3].at(fx, fy) * w;
+	}
+	if (Shader::attributes & attribute_uv)
+	{
+		in.u = attributes.u.at(fx, fy) * w;
+		in.v = attributes.v.at(fx, fy) * w;
+	}
+	if (Shader::attributes & attribute_uv_derivatives)
+	{
+		// d(u / inv_w) = (du - u * d(inv_w)) / inv_w, and the same for v.
+		in.du_dx = (attributes.u.dx - in.u * attributes.inv_w.dx) * w;
+		in.dv_dx = (attributes.v.dx - in.v * attributes.inv_w.dx) * w;
+		in.du_dy = (attributes.u.dy - in.u * attributes.inv_w.dy) * w;
+		in.dv_dy = (attributes.v.dy - in.v * attributes.inv_w.dy) * w;
+	}
+	return in;
+}
+
+template <typename Shader, blend_mode Blend, depth_compare Compare, bool Write>
+static bool run(const triangle_setup& triangle, const triangle_attributes& attributes, const pixel_resources& resources,
+                const screen_rect& rect, uint32_t* pixels, float* depths, const uint32_t stride)
+{
+	constexpr bool depth_test = Compare != depth_compare::always;
+	constexpr bool uses_depth = depth_test || Write;
+	bool wrote = false;
+
+	rasterizer::for_each_span(triangle, rect, [&](const int32_t y, const int32_t start, const int32_t end)
+	{
+		uint32_t* line = pixels + static_cast<size_t>(y) * stride;
+		float* depth_line = depths + static_cast<size_t>(y) * stride;
+		const auto fy = static_cast<float>(y);
+
+		// Evaluated per pixel rather than stepped, so a pixel's values do not depend on where its tile starts.
+		const float z_row = triangle.z_origin + triangle.z_dy * fy;
+
+		for (int32_t x = start; x < end; ++x)
+		{
+			const auto fx = static_cast<float>(x);
+
+			float z = 0;
+			if (uses_depth)
+			{
+				z = std::min(std::max(z_row + triangle.z_dx * fx, triangle.z_min), triangle.z_max);
+				if (depth_test && !depth_buffer::passes(Compare, z, depth_line[x])) continue;
+			}
+
+			const auto color = Shader::shade(triangle, interpolate<Shader>(attributes, fx, fy), resources);
+			line[x] = pixel_kernels::apply<Blend>(line[x], color);
+
+			if (Write)
+			{
+				depth_line[x] = z;
+				wrote = true;
+			}
+		}
+	});
+
+	return wrote;
+}
+
+template <typename Shader, blend_mode Blend, depth_compare Compare, bool Write>
+static bool run_multisampled(const triangle_setup& triangle, const triangle_attributes& attributes,
+                             const pixel_resources& resources, const screen_rect& rect, msaa_target& target,
+                             float* depths, const uint32_t stride)
+{
+	constexpr bool depth_test = Compare != depth_compare::always;
+	constexpr bool uses_depth = depth_test || Write;
+	bool wrote = false;
+
+	const auto shade_pixel = [&](const int32_t x, const int32_t y, const uint32_t mask, const bool center)
+	{
+		const auto fx = static_cast<float>(x);
+		const auto fy = static_cast<float>(y);
+		float& stored = depths[static_cast<size_t>(y) * stride + x];
+
+		// Depth at the center even when only samples are covered, the plane extends past the edges.
+		float z = 0;
+		if (uses_depth)
+		{
+			z = std::min(std::max(triangle.z_origin + triangle.z_dy * fy + triangle.z_dx * fx, triangle.z_min),
+			             triangle.z_max);
+			if (depth_test && !depth_buffer::passes(Compare, z, stored)) return;
+		}
+
+		const auto color = Shader::shade(triangle, interpolate<Shader>(attributes, fx, fy), resources);
+		target.write<Blend>(x, y, mask, color);
+
+		// The depth buffer holds what a single sampled draw would, the surfaces covering pixel centers.
+		if (Write && center)
+		{
+			stored = z;
+			wrote = true;
+		}
+	};
+	rasterizer::for_each_sample_mask(triangle, rect, target.get_pattern(), shade_pixel);
+
+	return wrote;
+}
+
+// The single or multisampled loop of one combination.
+template <bool Multisampled, typename Shader, blend_mode Blend, depth_compare Compare, bool Write>
+struct pipeline_entry
+{
+	static pixel_pipeline_function get() { return &run<Shader, Blend, Compare, Write>; }
+};
+
+template <typename Shader, blend_mode Blend, depth_compare Compare, bool Write>
+struct pipeline_entry<true, Shader, Blend, Compare, Write>
+{
+	static multisample_pipeline_function get() { return &run_multisampled<Shader, Blend, Compare, Write>; }
+};
+
+template <bool Multisampled, typename Shader, blend_mode Blend, depth_compare Compare>
+static auto select_write(const bool depth_write)
+{
+	return depth_write
+		       ? pipeline_entry<Multisampled, Shader, Blend, Compare, true>::get()
+		       : pipeline_entry<Multisampled, Shader, Blend, Compare, false>::get();
+}
+
+template <bool Multisampled, typename Shader, blend_mode Blend>
+static auto select_compare(const depth_compare compare, const bool depth_write)
+{
+	switch (compare)
+	{
+	case depth_compare::never: return select_write<Multisampled, Shader, Blend, depth_compare::never>(depth_write);
+	case depth_compare::less: return select_write<Multisampled, Shader, Blend, depth_compare::less>(depth_write);
+	case depth_compare::less_equal:
+		return select_write<Multisampled, Shader, Blend, depth_compare::less_equal>(depth_write);
+	case depth_compare::equal: return select_write<Multisampled, Shader, Blend, depth_compare::equal>(depth_write);
+	case depth_compare::greater_equal:
+		return select_write<Multisampled, Shader, Blend, depth_compare::greater_equal>(depth_write);
+	case depth_compare::greater: return select_write<Multisampled, Shader, Blend, depth_compare::greater>(depth_write);
+	case depth_compare::not_equal:
+		return select_write<Multisampled, Shader, Blend, depth_compare::not_equal>(depth_write);
+	default: return select_write<Multisampled, Shader, Blend, depth_compare::always>(depth_write);
+	}
+}
+
+template <bool Multisampled, typename Shader>
+static auto select_blend(const blend_mode blend, const depth_compare compare, const bool depth_write)
+{
+	switch (blend)
+	{
+	case blend_mode::alpha: return select_compare<Multisampled, Shader, blend_mode::alpha>(compare, depth_write);
+	case blend_mode::over: return select_compare<Multisampled, Shader, blend_mode::over>(compare, depth_write);
+	case blend_mode::add: return select_compare<Multisampled, Shader, blend_mode::add>(compare, depth_write);
+	case blend_mode::multiply: return select_compare<Multisampled, Shader, blend_mode::multiply>(compare, depth_write);
+	case blend_mode::screen: return select_compare<Multisampled, Shader, blend_mode::screen>(compare, depth_write);
+	default: return select_compare<Multisampled, Shader, blend_mode::replace>(compare, depth_write);
+	}
+}
+
+template <bool Multisampled>
+static auto select_shading(const shading shade, const blend_mode blend, const depth_compare compare,
+                           const bool depth_write, const texture_filter filter)
+{
+	switch (shade)
+	{
+	case shading::vertex_color: return select_blend<Multisampled, vertex_color_shader>(blend, compare, depth_write);
+	case shading::uv: return select_blend<Multisampled, uv_shader>(blend, compare, depth_write);
+	case shading::texture:
+		return filter == texture_filter::bilinear
+			       ? select_blend<Multisampled, texture_shader<texture_filter::bilinear>>(blend, compare, depth_write)
+			       : select_blend<Multisampled, texture_shader<texture_filter::nearest>>(blend, compare, depth_write);
+	default: return select_blend<Multisampled, flat_shader>(blend, compare, depth_write);
+	}
+}
+
+pixel_pipeline_function pixel_pipeline::select(const shading shade, const blend_mode blend, const depth_compare compare,
+                                               const bool depth_write, const texture_filter filter)
+{
+	return select_shading<false>(shade, blend, compare, depth_write, filter);
+}
+
+multisample_pipeline_function pixel_pipeline::select_multisampled(const shading shade, const blend_mode blend,
+                                                                  const depth_compare compare, const bool depth_write,
+                                                                  const texture_filter filter)
+{
+	return select_shading<true>(shade, blend, compare, depth_write, filter);
+}
+
+uint32_t pixel_pipeline::get_attributes(const shading shade)
+{
+	switch (shade)
+	{
+	case shading::vertex_color: return vertex_color_shader::attributes;
+	case shading::uv: return uv_shader::attributes;
+	case shading::texture: return texture_shader<texture_filter::bilinear>::attributes;
+	default: return flat_shader::attributes;
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+
+#include "depth_buffer.h"
+#include "pixel_kernels.h"
+#include "rasterizer.h"
+#include "texture.h"
+
+class msaa_target;
+
+// What a triangle's pixels are colored with.
+enum class shading
+{
+	// The first vertex color, nothing is interpolated.
+	flat,
+	// Perspective correct vertex colors.
+	vertex_color,
+	// Texture coordinates as red and green, for checking the uv path.
+	uv,
+	// The texture sampled at the texture coordinates, its mip picked per pixel.
+	texture
+};
+
+// Attributes a shader asks the pipeline to interpolate.
+enum attribute_flags : uint32_t
+{
+	attribute_none = 0,
+	attribute_color = 1 << 0,
+	attribute_uv = 1 << 1,
+	// Screen space derivatives of u and v, for picking a mip.
+	attribute_uv_derivatives = 1 << 2
+};
+
+// Perspective corrected attributes of one pixel, only the ones the shader asked for are filled.
+struct pixel_inputs
+{
+	float a, r, g, b;
+	float u, v;
+	float du_dx, dv_dx, du_dy, dv_dy;
+};
+
+// What shaders read besides the triangle, the same for the whole draw.
+struct pixel_resources
+{
+	const texture* image = nullptr;
+};
+
+// Rasterizes the pixels of rect covered by the triangle, returns true when any depth was written.
+using pixel_pipeline_function = bool (*)(const triangle_setup& triangle, const triangle_attributes& attributes,
+                                         const pixel_resources& resources, const screen_rect& rect, uint32_t* pixels,
+                                         float* depths, uint32_t stride);
+
+// The same into the samples of a multisampled target. Pixels are shaded once at their center and the color goes
+// to every covered sample. Depth stays one value per pixel, tested at the center and written where it is covered.
+using multisample_pipeline_function = bool (*)(const triangle_setup& triangle, const triangle_attributes& attributes,
+                                               const pixel_resources& resources, const screen_rect& rect,
+                                               msaa_target& target, float* depths, uint32_t stride);
+
+// Pixel loops specialized at compile time on shading, texture filter, blend mode, depth compare and depth write.
+// Draw state is resolved once per draw call by picking the matching loop, the inner loop has no
+// branches on it. Depth is skipped entirely for always without writes.
+class pixel_pipeline
+{
+public:
+	// filter only matters for texture shading, which needs a texture in the resources.
+	static pixel_pipeline_function select(shading shade, blend_mode blend, depth_compare compare, bool depth_write,
+	                                      texture_filter filter = texture_filter::bilinear);
+
+	static multisample_pipeline_function select_multisampled(shading shade, blend_mode blend, depth_compare compare,
+	                                                         bool depth_write,
+	                                                         texture_filter filter = texture_filter::bilinear);
+
+	// Attributes the shading needs set up per triangle.
+	static uint32_t get_attributes(shading shade);
+};
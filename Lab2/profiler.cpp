@@ -0,0 +1,195 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+std::atomic<bool> profiler::enabled_{ false };
+
+// Fields are relaxed atomics so the exporter may read while the owner writes, head tells it which are settled.
+struct profile_event
+{
+	std::atomic<const char*> name{ nullptr };
+	std::atomic<uint64_t> start{ 0 };
+	std::atomic<uint64_t> duration{ 0 };
+};
+
+// Single producer ring, only the owning thread writes.
+struct thread_ring
+{
+	std::atomic<uint64_t> head{ 0 };
+	uint32_t thread_index = 0;
+	std::string thread_name;
+	profile_event events[profiler::ring_size];
+};
+
+static std::mutex registry_mutex;
+
+// Rings outlive their threads so a trace can be written after the workers are gone.
+static std::vector<std::unique_ptr<thread_ring>>& registry()
+{
+	static std::vector<std::unique_ptr<thread_ring>> rings;
+	return rings;
+}
+
+static thread_ring& local_ring()
+{
+	thread_local thread_ring* ring = nullptr;
+
+	if (!ring)
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		auto& rings = registry();
+		rings.push_back(std::make_unique<thread_ring>());
+		ring = rings.back().get();
+		ring->thread_index = static_cast<uint32_t>(rings.size() - 1);
+	}
+	return *ring;
+}
+
+static std::atomic<uint64_t> frame_times[profiler::frame_window];
+static std::atomic<uint64_t> frame_count{ 0 };
+static std::atomic<uint64_t> last_frame{ 0 };
+
+void profiler::set_enabled(const bool enabled)
+{
+	// Start the clock before the first zone reads it.
+	now();
+	enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t profiler::now()
+{
+	using clock = std::chrono::steady_clock;
+	static const auto epoch = clock::now();
+
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch).count());
+}
+
+void profiler::record(const char* name, const uint64_t start, const uint64_t end)
+{
+	auto& ring = local_ring();
+	const auto head = ring.head.load(std::memory_order_relaxed);
+	auto& event = ring.events[head & (ring_size - 1)];
+
+	// Keeps the slot writes after the previous head store, the exporter relies on it to spot overwrites.
+	std::atomic_thread_fence(std::memory_order_release);
+	event.name.store(name, std::memory_order_relaxed);
+	event.start.store(start, std::memory_order_relaxed);
+	event.duration.store(end - start, std::memory_order_relaxed);
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+void profiler::set_thread_name(const char* name)
+{
+	if (!is_enabled()) return;
+
+	auto& ring = local_ring();
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	ring.thread_name = name;
+}
+
+void profiler::mark_frame()
+{
+	if (!is_enabled()) return;
+
+	const auto time = now();
+	const auto previous = last_frame.exchange(time, std::memory_order_relaxed);
+	if (previous == 0) return;
+
+	const auto index = frame_count.load(std::memory_order_relaxed);
+	frame_times[index % frame_window].store(time - previous, std::memory_order_relaxed);
+	frame_count.store(index + 1, std::memory_order_release);
+}
+
+frame_stats profiler::get_frame_stats()
+{
+	const auto count = frame_count.load(std::memory_order_acquire);
+	const auto kept = static_cast<uint32_t>(std::min<uint64_t>(count, frame_window));
+
+	frame_stats stats{ kept, 0, 0, 0, 0 };
+	if (kept == 0) return stats;
+
+	std::vector<uint64_t> times(kept);
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < kept; ++i)
+	{
+		times[i] = frame_times[i].load(std::memory_order_relaxed);
+		total += times[i];
+	}
+	std::sort(times.begin(), times.end());
+
+	// Nearest rank percentiles.
+	const auto percentile = [&](const double p)
+	{
+		const auto rank = static_cast<uint32_t>(p * kept + 0.999999);
+		return times[std::max(rank, 1u) - 1] / 1e6;
+	};
+
+	stats.mean_ms = total / 1e6 / kept;
+	stats.p50_ms = percentile(0.50);
+	stats.p99_ms = percentile(0.99);
+	stats.max_ms = times.back() / 1e6;
+	return stats;
+}
+
+bool profiler::write_chrome_trace(const char* path)
+{
+	FILE* file = std::fopen(path, "w");
+	if (!file) return false;
+
+	std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first = true;
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	for (const auto& ring : registry())
+	{
+		if (!ring->thread_name.empty())
+		{
+			std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			             first ? "" : ",\n", ring->thread_index, ring->thread_name.c_str());
+			first = false;
+		}
+
+		const auto head = ring->head.load(std::memory_order_acquire);
+		const auto begin = head > ring_size ? head - ring_size : 0;
+
+		struct event_copy
+		{
+			const char* name;
+			uint64_t start;
+			uint64_t duration;
+		};
+
+		std::vector<event_copy> events(static_cast<size_t>(head - begin));
+		for (auto i = begin; i < head; ++i)
+		{
+			const auto& event = ring->events[i & (ring_size - 1)];
+			events[static_cast<size_t>(i - begin)] = {
+				event.name.load(std::memory_order_relaxed), event.start.load(std::memory_order_relaxed),
+				event.duration.load(std::memory_order_relaxed)
+			};
+		}
+
+		// The owner kept recording meanwhile, drop the slots it may have overwritten.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const auto settled = ring->head.load(std::memory_order_relaxed);
+		const auto valid = settled >= ring_size ? std::max(begin, settled - ring_size + 1) : begin;
+
+		for (auto i = valid; i < head; ++i)
+		{
+			const auto& event = events[static_cast<size_t>(i - begin)];
+			std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			             first ? "" : ",\n", event.name, ring->thread_index, event.start / 1e3, event.duration / 1e3);
+			first = false;
+		}
+	}
+
+	std::fprintf(file, "\n]}\n");
+	return std::fclose(file) == 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Frame time summary over the most recent frames.
+struct frame_stats
+{
+	uint32_t frame_count;
+	double mean_ms;
+	double p50_ms;
+	double p99_ms;
+	double max_ms;
+};
+
+// Low overhead instrumentation. Zones are timed with steady_clock and written to a ring owned by the
+// recording thread, so recording never takes a lock. Rings keep the newest events per thread and can be
+// exported as a Chrome trace (chrome://tracing, Perfetto). Disabled by default, a disabled zone costs one load.
+class profiler
+{
+public:
+	// Events kept per thread, older ones are overwritten.
+	static constexpr uint32_t ring_size = 1 << 14;
+
+	// Frames the percentile summary covers.
+	static constexpr uint32_t frame_window = 512;
+
+	static void set_enabled(bool enabled);
+
+	static bool is_enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+	// Nanoseconds since the profiler was first used.
+	static uint64_t now();
+
+	static void record(const char* name, uint64_t start, uint64_t end);
+
+	// Labels the calling thread in the exported trace, ignored while disabled so idle threads get no ring.
+	static void set_thread_name(const char* name);
+
+	// Called once per presented frame, the time between calls is the frame time.
+	static void mark_frame();
+
+	static frame_stats get_frame_stats();
+
+	// Writes every thread's retained events in Chrome trace event format, returns false if the file cannot be written.
+	static bool write_chrome_trace(const char* path);
+
+private:
+	static std::atomic<bool> enabled_;
+};
+
+// Times the enclosing scope, name has to outlive the profiler (use string literals).
+class profile_zone
+{
+public:
+	explicit profile_zone(const char* name) : name_(name), active_(profiler::is_enabled()), start_(active_ ? profiler::now() : 0)
+	{
+	}
+
+	~profile_zone()
+	{
+		if (active_) profiler::record(name_, start_, profiler::now());
+	}
+
+	profile_zone(const profile_zone& other) = delete;
+
+	profile_zone& operator=(const profile_zone& other) = delete;
+
+private:
+	const char* name_;
+	bool active_;
+	uint64_t start_;
+};
+
+#define LAB2_PROFILE_CONCAT_INNER(a, b) a##b
+#define LAB2_PROFILE_CONCAT(a, b) LAB2_PROFILE_CONCAT_INNER(a, b)
+
+// Defining LAB2_NO_PROFILER compiles every zone out.
+#ifdef LAB2_NO_PROFILER
+#define LAB2_PROFILE_ZONE(name)
+#else
+#define LAB2_PROFILE_ZONE(name) const profile_zone LAB2_PROFILE_CONCAT(profile_zone_, __LINE__){ name }
+#endif
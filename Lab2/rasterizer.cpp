@@ -0,0 +1,367 @@
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "engine_data.h"
+#include "pixel_kernels.h"
+
+// a / b rounded towards negative infinity, b must be positive.
+static int64_t floor_div(const int64_t a, const int64_t b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// a / b rounded towards positive infinity, b must be positive.
+static int64_t ceil_div(const int64_t a, const int64_t b)
+{
+	return -floor_div(-a, b);
+}
+
+// Narrows the major span [first, last) of a line whose minor position at major pixel i is base + i * step
+// to the pixels with a minor position in [minor_min, minor_max), returns false when none are left.
+static bool narrow_line(int64_t& first, int64_t& last, const int64_t base, const int64_t step, const int64_t minor_min,
+                        const int64_t minor_max)
+{
+	if (step > 0)
+	{
+		first = std::max(first, ceil_div(minor_min - base, step));
+		last = std::min(last, ceil_div(minor_max - base, step));
+	}
+	else if (step < 0)
+	{
+		first = std::max(first, floor_div(base - minor_max, -step) + 1);
+		last = std::min(last, floor_div(base - minor_min, -step) + 1);
+	}
+	else if (base < minor_min || base >= minor_max)
+	{
+		return false;
+	}
+
+	return first < last;
+}
+
+bool rasterizer::setup_line(line_setup& out, const vec2& start, const vec2& end, const uint32_t color,
+                            const uint32_t width, const uint32_t height, const line_mode mode)
+{
+	// Liang-Barsky against the screen grown by a pixel, keeps the fixed point math in range.
+	const double dx = end.x - start.x;
+	const double dy = end.y - start.y;
+	const double p[4] = { -dx, dx, -dy, dy };
+	const double q[4] = { start.x + 1, width + 1 - start.x, start.y + 1, height + 1 - start.y };
+
+	double t0 = 0;
+	double t1 = 1;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (p[i] == 0)
+		{
+			if (q[i] < 0) return false;
+			continue;
+		}
+
+		const double t = q[i] / p[i];
+		if (p[i] < 0) t0 = std::max(t0, t);
+		else t1 = std::min(t1, t);
+	}
+	if (t0 > t1) return false;
+
+	constexpr int64_t one = 1 << line_sub_pixel_bits;
+	constexpr int64_t half = one / 2;
+	constexpr int64_t minor_one = int64_t(1) << (minor_bits - line_sub_pixel_bits);
+
+	int64_t x0 = std::llround((start.x + t0 * dx) * one);
+	int64_t y0 = std::llround((start.y + t0 * dy) * one);
+	int64_t x1 = std::llround((start.x + t1 * dx) * one);
+	int64_t y1 = std::llround((start.y + t1 * dy) * one);
+
+	out.color = color;
+	out.y_major = std::abs(y1 - y0) > std::abs(x1 - x0);
+	out.smooth = mode == line_mode::smooth;
+
+	// Step along the longer axis, below x stands for the major axis and y for the minor one.
+	if (out.y_major)
+	{
+		std::swap(x0, y0);
+		std::swap(x1, y1);
+	}
+	const int64_t major_size = out.y_major ? height : width;
+	const int64_t minor_size = out.y_major ? width : height;
+	out.minor_min = 0;
+	out.minor_max = static_cast<int32_t>(minor_size);
+
+	// A smooth line steps the upper pixel of each pair, which is on screen from a pixel above it.
+	const int64_t minor_shift = out.smooth ? int64_t(1) << (minor_bits - 1) : 0;
+	const int64_t minor_start = out.smooth ? -(int64_t(1) << minor_bits) : 0;
+	const int64_t minor_end = minor_size << minor_bits;
+
+	if (x0 > x1)
+	{
+		std::swap(x0, x1);
+		std::swap(y0, y1);
+	}
+
+	if (x1 == x0)
+	{
+		// Shorter than a sub pixel, draw the one pixel it sits in.
+		const int64_t pixel = floor_div(x0, one);
+		const int64_t minor = y0 * minor_one - minor_shift;
+		if (pixel < 0 || pixel >= major_size || minor < minor_start || minor >= minor_end) return false;
+
+		out.first = static_cast<int32_t>(pixel);
+		out.last = out.first + 1;
+		out.minor = minor;
+		out.step = 0;
+		return true;
+	}
+
+	int64_t first = ceil_div(x0 - half, one);
+	int64_t last = ceil_div(x1 - half, one);
+
+	// Minor position at the center of major pixel i is base + i * step.
+	const int64_t slope = (y1 - y0) * minor_one / (x1 - x0);
+	const int64_t base = y0 * minor_one + (half - x0) * slope - minor_shift;
+	const int64_t step = slope * one;
+
+	first = std::max<int64_t>(first, 0);
+	last = std::min(last, major_size);
+
+	// Narrow the major span to where the minor axis is on screen, no pixel needs a bounds check after this.
+	if (!narrow_line(first, last, base, step, minor_start, minor_end)) return false;
+
+	out.first = static_cast<int32_t>(first);
+	out.last = static_cast<int32_t>(last);
+	out.minor = base + first * step;
+	out.step = step;
+
+	return true;
+}
+
+bool rasterizer::clip_line(line_setup& line, const screen_rect& rect)
+{
+	const int64_t major_min = line.y_major ? rect.min_y : rect.min_x;
+	const int64_t major_max = line.y_major ? rect.max_y : rect.max_x;
+	const int32_t minor_min = std::max(line.minor_min, line.y_major ? rect.min_x : rect.min_y);
+	const int32_t minor_max = std::min(line.minor_max, line.y_major ? rect.max_x : rect.max_y);
+
+	// Same narrowing as setup_line, the minor position of major pixel i stays base + i * step.
+	const int64_t base = line.minor - line.first * line.step;
+	int64_t first = std::max<int64_t>(line.first, major_min);
+	int64_t last = std::min<int64_t>(line.last, major_max);
+
+	if (minor_min >= minor_max) return false;
+
+	// Smooth lines step the upper pixel of each pair, from a pixel above the rectangle.
+	constexpr int64_t minor_one = int64_t(1) << minor_bits;
+	const int64_t minor_start = (minor_min - (line.smooth ? 1 : 0)) * minor_one;
+	if (!narrow_line(first, last, base, line.step, minor_start, minor_max * minor_one)) return false;
+
+	line.minor_min = minor_min;
+	line.minor_max = minor_max;
+	line.first = static_cast<int32_t>(first);
+	line.last = static_cast<int32_t>(last);
+	line.minor = base + first * line.step;
+	return true;
+}
+
+void rasterizer::rasterize_line(const line_setup& line, uint32_t* pixels, const uint32_t stride)
+{
+	const auto alpha = line.color >> 24;
+	if (alpha == 0) return;
+
+	if (alpha == 0xFF && !line.smooth)
+	{
+		for_each_line_pixel(line, [&](const int32_t x, const int32_t y, uint32_t)
+		{
+			pixels[static_cast<size_t>(y) * stride + x] = line.color;
+		});
+		return;
+	}
+
+	// Full coverage keeps the alpha as it is, div_255 is exact.
+	const uint32_t rgb = line.color & 0x00FFFFFF;
+	for_each_line_pixel(line, [&](const int32_t x, const int32_t y, const uint32_t coverage)
+	{
+		auto& target = pixels[static_cast<size_t>(y) * stride + x];
+		target = pixel_kernels::blend_pixel(target, rgb | pixel_kernels::div_255(alpha * coverage) << 24);
+	});
+}
+
+// Snaps a vertex position to the sub pixel grid.
+static void snap(const vertex& v, int64_t& x, int64_t& y)
+{
+	x = std::llround(v.x * rasterizer::sub_pixel_one);
+	y = std::llround(v.y * rasterizer::sub_pixel_one);
+}
+
+// Fits value = origin + dx * x + dy * y through three snapped positions, evaluated at pixel centers.
+static attribute_plane fit_plane(const int64_t x[3], const int64_t y[3], const double value[3])
+{
+	constexpr double scale = 1.0 / rasterizer::sub_pixel_one;
+	const double x0 = x[0] * scale, x1 = x[1] * scale, x2 = x[2] * scale;
+	const double y0 = y[0] * scale, y1 = y[1] * scale, y2 = y[2] * scale;
+	const double d1 = value[1] - value[0];
+	const double d2 = value[2] - value[0];
+	const double determinant = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+
+	const double dx = (d1 * (y2 - y0) - d2 * (y1 - y0)) / determinant;
+	const double dy = (d2 * (x1 - x0) - d1 * (x2 - x0)) / determinant;
+
+	return {
+		static_cast<float>(dx), static_cast<float>(dy),
+		static_cast<float>(value[0] + dx * (0.5 - x0) + dy * (0.5 - y0))
+	};
+}
+
+bool rasterizer::setup_triangle(triangle_setup& out, const vertex& v0, const vertex& v1, const vertex& v2,
+                                const uint32_t width, const uint32_t height)
+{
+	const vertex* v[3] = { &v0, &v1, &v2 };
+
+	int64_t x[3];
+	int64_t y[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		if (std::abs(v[i]->x) > guard_band || std::abs(v[i]->y) > guard_band) return false;
+
+		snap(*v[i], x[i], y[i]);
+	}
+
+	// Twice the signed area, zero area triangles cover nothing.
+	const int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+	if (area == 0) return false;
+
+	// Depth is affine in screen space, fit its plane through the snapped vertex positions.
+	{
+		const double z[3] = { v0.z, v1.z, v2.z };
+		const auto plane = fit_plane(x, y, z);
+
+		out.z_dx = plane.dx;
+		out.z_dy = plane.dy;
+		out.z_origin = plane.origin;
+		out.z_min = static_cast<float>(std::min({ v0.z, v1.z, v2.z }));
+		out.z_max = static_cast<float>(std::max({ v0.z, v1.z, v2.z }));
+	}
+
+	// Both windings are drawn, flip the negative one so the inside is always positive.
+	if (area < 0)
+	{
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		const int j = (i + 1) % 3;
+
+		out.a[i] = y[i] - y[j];
+		out.b[i] = x[j] - x[i];
+		out.c[i] = x[i] * y[j] - y[i] * x[j];
+
+		// Top-left fill rule, pixels exactly on a right or bottom edge belong to the neighbour.
+		const bool top_left = out.a[i] > 0 || (out.a[i] == 0 && out.b[i] > 0);
+		if (!top_left) out.c[i] -= 1;
+	}
+
+	const auto min_x = std::min({ x[0], x[1], x[2] }) >> sub_pixel_bits;
+	const auto min_y = std::min({ y[0], y[1], y[2] }) >> sub_pixel_bits;
+	const auto max_x = (std::max({ x[0], x[1], x[2] }) >> sub_pixel_bits) + 1;
+	const auto max_y = (std::max({ y[0], y[1], y[2] }) >> sub_pixel_bits) + 1;
+
+	out.bounds.min_x = static_cast<int32_t>(std::max<int64_t>(min_x, 0));
+	out.bounds.min_y = static_cast<int32_t>(std::max<int64_t>(min_y, 0));
+	out.bounds.max_x = static_cast<int32_t>(std::min<int64_t>(max_x, width));
+	out.bounds.max_y = static_cast<int32_t>(std::min<int64_t>(max_y, height));
+
+	out.color = v0.color.convert();
+
+	return out.bounds.min_x < out.bounds.max_x && out.bounds.min_y < out.bounds.max_y;
+}
+
+void rasterizer::setup_attributes(triangle_attributes& out, const vertex& v0, const vertex& v1, const vertex& v2)
+{
+	const vertex* v[3] = { &v0, &v1, &v2 };
+
+	int64_t x[3];
+	int64_t y[3];
+	double inv_w[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		snap(*v[i], x[i], y[i]);
+		inv_w[i] = v[i]->w != 0 ? 1.0 / v[i]->w : 1.0;
+	}
+
+	// Attributes divided by w are affine in screen space, the pixel divides by the interpolated 1 / w again.
+	const auto fit = [&](const double a, const double b, const double c)
+	{
+		const double value[3] = { a * inv_w[0], b * inv_w[1], c * inv_w[2] };
+		return fit_plane(x, y, value);
+	};
+
+	out.inv_w = fit(1, 1, 1);
+	out.color[0] = fit(v0.color.a(), v1.color.a(), v2.color.a());
+	out.color[1] = fit(v0.color.r(), v1.color.r(), v2.color.r());
+	out.color[2] = fit(v0.color.g(), v1.color.g(), v2.color.g());
+	out.color[3] = fit(v0.color.b(), v1.color.b(), v2.color.b());
+	out.u = fit(v0.u, v1.u, v2.u);
+	out.v = fit(v0.v, v1.v, v2.v);
+}
+
+const sample_pattern& sample_pattern::get(const uint32_t count)
+{
+	static const sample_pattern patterns[] = {
+		{ 1, { 0 }, { 0 } },
+		{ 2, { 4, -4 }, { 4, -4 } },
+		{ 4, { -2, 6, -6, 2 }, { -6, -2, 2, 6 } },
+		{ 8, { 1, -1, 5, -3, -5, -7, 3, 7 }, { -3, 3, 1, -5, 5, -1, 7, -7 } }
+	};
+	return count >= 8 ? patterns[3] : count >= 4 ? patterns[2] : count >= 2 ? patterns[1] : patterns[0];
+}
+
+bool rasterizer::overlaps(const triangle_setup& triangle, const screen_rect& rect, const sample_pattern* pattern)
+{
+	const int32_t min_x = std::max(rect.min_x, triangle.bounds.min_x);
+	const int32_t min_y = std::max(rect.min_y, triangle.bounds.min_y);
+	const int32_t max_x = std::min(rect.max_x, triangle.bounds.max_x);
+	const int32_t max_y = std::min(rect.max_y, triangle.bounds.max_y);
+	if (min_x >= max_x || min_y >= max_y) return false;
+
+	constexpr int64_t half = sub_pixel_one / 2;
+
+	// The rectangle is outside if any edge is negative even at its most inside pixel, or sample.
+	for (int i = 0; i < 3; ++i)
+	{
+		const int64_t x = (static_cast<int64_t>(triangle.a[i] >= 0 ? max_x - 1 : min_x) << sub_pixel_bits) + half;
+		const int64_t y = (static_cast<int64_t>(triangle.b[i] >= 0 ? max_y - 1 : min_y) << sub_pixel_bits) + half;
+
+		int64_t reach = 0;
+		for (uint32_t s = 0; pattern && s < pattern->count; ++s)
+			reach = std::max(reach, triangle.a[i] * pattern->x[s] + triangle.b[i] * pattern->y[s]);
+
+		if (triangle.a[i] * x + triangle.b[i] * y + triangle.c[i] + reach < 0) return false;
+	}
+
+	return true;
+}
+
+void rasterizer::rasterize(const triangle_setup& triangle, const screen_rect& rect, uint32_t* pixels,
+                           const uint32_t stride, const blend_mode mode)
+{
+	const auto& kernels = pixel_kernels::get();
+	const auto alpha = triangle.color >> 24;
+
+	// Nothing premultiplied by zero changes the target in any mode.
+	if (alpha == 0) return;
+
+	const bool composites = mode != blend_mode::replace && mode != blend_mode::alpha;
+	const uint32_t premultiplied = pixel_kernels::premultiply(triangle.color);
+
+	for_each_span(triangle, rect, [&](const int32_t y, const int32_t start, const int32_t end)
+	{
+		uint32_t* line = pixels + static_cast<size_t>(y) * stride;
+
+		if (composites) kernels.composite_fill(line + start, premultiplied, end - start, mode);
+		else if (alpha == 0xFF) kernels.fill(line + start, triangle.color, end - start);
+		else kernels.blend_fill(line + start, triangle.color, end - start);
+	});
+}
@@ -0,0 +1,351 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+#include "pixel_kernels.h"
+
+struct vec2;
+struct vertex;
+
+// Screen rectangle, min inclusive and max exclusive.
+struct screen_rect
+{
+	int32_t min_x;
+	int32_t min_y;
+	int32_t max_x;
+	int32_t max_y;
+};
+
+// A screen space triangle prepared for edge function traversal.
+struct triangle_setup
+{
+	// Edge functions e(x, y) = a * x + b * y + c over sub pixel coordinates.
+	// A pixel is covered when all three are non-negative at its center.
+	int64_t a[3];
+	int64_t b[3];
+	int64_t c[3];
+
+	// Pixels touched by the triangle, already clamped to the screen.
+	screen_rect bounds;
+
+	// Depth plane, the depth at the center of pixel (x, y) is z_origin + z_dx * x + z_dy * y,
+	// clamped to the vertex range [z_min, z_max].
+	float z_origin;
+	float z_dx;
+	float z_dy;
+	float z_min;
+	float z_max;
+
+	uint32_t color;
+};
+
+// Screen space plane of one value, at the center of pixel (x, y) it is origin + dx * x + dy * y.
+struct attribute_plane
+{
+	float dx;
+	float dy;
+	float origin;
+
+	float at(const float x, const float y) const { return origin + dx * x + dy * y; }
+};
+
+// Interpolation planes of a triangle's vertex attributes. Everything but inv_w is divided by w,
+// so value = plane.at(x, y) / inv_w.at(x, y) is perspective correct.
+struct triangle_attributes
+{
+	attribute_plane inv_w;
+	// a, r, g, b in 0 to 255.
+	attribute_plane color[4];
+	attribute_plane u;
+	attribute_plane v;
+};
+
+enum class line_mode
+{
+	// One pixel per step along the major axis.
+	aliased,
+	// Wu lines, each step splits its coverage between the two pixels nearest the line on the minor axis.
+	smooth
+};
+
+// A line clipped to the screen and converted to fixed point, ready to step.
+struct line_setup
+{
+	// Pixels along the major axis, first inclusive and last exclusive.
+	int32_t first;
+	int32_t last;
+
+	// Minor axis position at the first pixel center and its step per pixel, minor_bits fractional bits.
+	// Smooth lines keep it half a pixel lower, at the center of the upper pixel of each pair.
+	int64_t minor;
+	int64_t step;
+
+	// Minor axis pixels smooth lines may write, first inclusive and last exclusive.
+	int32_t minor_min;
+	int32_t minor_max;
+
+	// Steep lines step over rows instead of columns.
+	bool y_major;
+	bool smooth;
+
+	uint32_t color;
+};
+
+// Sample positions of a multisampled pixel in sub pixels from its center, the standard 2, 4 and 8 sample
+// patterns. They sit on the 1/16 grid, which is the sub pixel grid of triangles.
+struct sample_pattern
+{
+	uint32_t count;
+	int8_t x[8];
+	int8_t y[8];
+
+	// count is 1, 2, 4 or 8, one sample sits at the center.
+	static const sample_pattern& get(uint32_t count);
+};
+
+class rasterizer
+{
+public:
+	// Sub pixel precision of triangle vertices.
+	static constexpr int32_t sub_pixel_bits = 4;
+	static constexpr int32_t sub_pixel_one = 1 << sub_pixel_bits;
+
+	// Vertices further out than this are rejected rather than risking edge function overflow.
+	static constexpr double guard_band = 1 << 23;
+
+	// Sub pixel precision of line end points.
+	static constexpr int32_t line_sub_pixel_bits = 8;
+
+	// Fractional bits of the stepped minor axis of a line.
+	static constexpr int32_t minor_bits = line_sub_pixel_bits + 32;
+
+	// Clips a line to the screen and builds its stepping, returns false when nothing is left to draw.
+	// Pixels whose center lies on the major axis span [start, end) are drawn, so joined lines never overlap.
+	static bool setup_line(line_setup& out, const vec2& start, const vec2& end, uint32_t color,
+	                       uint32_t width, uint32_t height, line_mode mode = line_mode::aliased);
+
+	// Narrows a set up line to the pixels inside rect, exactly the ones the whole line draws there.
+	// Returns false when none are left.
+	static bool clip_line(line_setup& line, const screen_rect& rect);
+
+	// Steps a clipped line, every pixel it touches is on screen. Smooth lines blend the color with its alpha
+	// scaled by the coverage of each pixel, the two coverages of a step add up to 255.
+	static void rasterize_line(const line_setup& line, uint32_t* pixels, uint32_t stride);
+
+	// Calls plot(x, y, coverage) for every pixel rasterize_line touches, coverage is 255 for aliased lines.
+	template <typename Plot>
+	static void for_each_line_pixel(const line_setup& line, Plot&& plot);
+
+	// Builds the edge functions of a triangle, returns false when it covers no pixel of the screen.
+	static bool setup_triangle(triangle_setup& out, const vertex& v0, const vertex& v1, const vertex& v2,
+	                           uint32_t width, uint32_t height);
+
+	// True when the triangle may cover a pixel of the rectangle, or with a pattern any of its samples.
+	static bool overlaps(const triangle_setup& triangle, const screen_rect& rect, const sample_pattern* pattern = nullptr);
+
+	// Fills (or blends, when translucent) the pixels of rect covered by the triangle, the premultiplied modes
+	// composite every pixel. stride is the width of the pixel buffer.
+	static void rasterize(const triangle_setup& triangle, const screen_rect& rect, uint32_t* pixels, uint32_t stride,
+	                      blend_mode mode = blend_mode::alpha);
+
+	// Fits the attribute planes of a triangle accepted by setup_triangle from the same vertices.
+	static void setup_attributes(triangle_attributes& out, const vertex& v0, const vertex& v1, const vertex& v2);
+
+	// Calls span(y, start, end) for every row of rect with covered pixels [start, end).
+	template <typename Span>
+	static void for_each_span(const triangle_setup& triangle, const screen_rect& rect, Span&& span);
+
+	// Calls pixel(x, y, mask, center) for every pixel of rect with a covered sample. Bit i of mask is sample i
+	// of the pattern, center tells whether the pixel center is covered too.
+	template <typename Pixel>
+	static void for_each_sample_mask(const triangle_setup& triangle, const screen_rect& rect,
+	                                 const sample_pattern& pattern, Pixel&& pixel);
+
+private:
+	template <bool y_major, typename Plot>
+	static void step_line(const line_setup& line, Plot& plot);
+
+	template <bool y_major, typename Plot>
+	static void step_smooth_line(const line_setup& line, Plot& plot);
+};
+
+template <bool y_major, typename Plot>
+void rasterizer::step_line(const line_setup& line, Plot& plot)
+{
+	int64_t minor = line.minor;
+
+	for (int32_t i = line.first; i < line.last; ++i)
+	{
+		const auto m = static_cast<int32_t>(minor >> minor_bits);
+		if (y_major) plot(m, i, 255u);
+		else plot(i, m, 255u);
+		minor += line.step;
+	}
+}
+
+template <bool y_major, typename Plot>
+void rasterizer::step_smooth_line(const line_setup& line, Plot& plot)
+{
+	int64_t minor = line.minor;
+
+	for (int32_t i = line.first; i < line.last; ++i)
+	{
+		// The upper pixel gets the part of the coverage the line is away from the lower one.
+		const auto m = static_cast<int32_t>(minor >> minor_bits);
+		const auto lower = static_cast<uint32_t>(minor >> (minor_bits - 8)) & 0xFF;
+
+		if (m >= line.minor_min)
+		{
+			if (y_major) plot(m, i, 255 - lower);
+			else plot(i, m, 255 - lower);
+		}
+		if (m + 1 < line.minor_max)
+		{
+			if (y_major) plot(m + 1, i, lower);
+			else plot(i, m + 1, lower);
+		}
+		minor += line.step;
+	}
+}
+
+template <typename Plot>
+void rasterizer::for_each_line_pixel(const line_setup& line, Plot&& plot)
+{
+	if (line.smooth)
+	{
+		if (line.y_major) step_smooth_line<true>(line, plot);
+		else step_smooth_line<false>(line, plot);
+	}
+	else
+	{
+		if (line.y_major) step_line<true>(line, plot);
+		else step_line<false>(line, plot);
+	}
+}
+
+template <typename Span>
+void rasterizer::for_each_span(const triangle_setup& triangle, const screen_rect& rect, Span&& span)
+{
+	const int32_t min_x = std::max(rect.min_x, triangle.bounds.min_x);
+	const int32_t min_y = std::max(rect.min_y, triangle.bounds.min_y);
+	const int32_t max_x = std::min(rect.max_x, triangle.bounds.max_x);
+	const int32_t max_y = std::min(rect.max_y, triangle.bounds.max_y);
+	if (min_x >= max_x || min_y >= max_y) return;
+
+	constexpr int64_t half = sub_pixel_one / 2;
+	const int64_t start_x = (static_cast<int64_t>(min_x) << sub_pixel_bits) + half;
+	const int64_t start_y = (static_cast<int64_t>(min_y) << sub_pixel_bits) + half;
+
+	// Evaluate once at the first pixel center, then only step.
+	int64_t row[3];
+	int64_t step_x[3];
+	int64_t step_y[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		row[i] = triangle.a[i] * start_x + triangle.b[i] * start_y + triangle.c[i];
+		step_x[i] = triangle.a[i] * sub_pixel_one;
+		step_y[i] = triangle.b[i] * sub_pixel_one;
+	}
+
+	for (int32_t y = min_y; y < max_y; ++y)
+	{
+		int64_t w0 = row[0];
+		int64_t w1 = row[1];
+		int64_t w2 = row[2];
+
+		// Triangles are convex, the covered pixels of a row form one span.
+		int32_t x = min_x;
+		for (; x < max_x && (w0 | w1 | w2) < 0; ++x)
+		{
+			w0 += step_x[0];
+			w1 += step_x[1];
+			w2 += step_x[2];
+		}
+
+		const int32_t span_start = x;
+		for (; x < max_x && (w0 | w1 | w2) >= 0; ++x)
+		{
+			w0 += step_x[0];
+			w1 += step_x[1];
+			w2 += step_x[2];
+		}
+
+		if (x > span_start) span(y, span_start, x);
+
+		row[0] += step_y[0];
+		row[1] += step_y[1];
+		row[2] += step_y[2];
+	}
+}
+
+template <typename Pixel>
+void rasterizer::for_each_sample_mask(const triangle_setup& triangle, const screen_rect& rect,
+                                      const sample_pattern& pattern, Pixel&& pixel)
+{
+	const int32_t min_x = std::max(rect.min_x, triangle.bounds.min_x);
+	const int32_t min_y = std::max(rect.min_y, triangle.bounds.min_y);
+	const int32_t max_x = std::min(rect.max_x, triangle.bounds.max_x);
+	const int32_t max_y = std::min(rect.max_y, triangle.bounds.max_y);
+	if (min_x >= max_x || min_y >= max_y) return;
+
+	constexpr int64_t half = sub_pixel_one / 2;
+	const int64_t start_x = (static_cast<int64_t>(min_x) << sub_pixel_bits) + half;
+	const int64_t start_y = (static_cast<int64_t>(min_y) << sub_pixel_bits) + half;
+
+	// Edge values of every sample relative to the pixel center, and their range per edge. A pixel is covered
+	// whole when every edge clears its lowest offset and not at all when one misses its highest.
+	int64_t row[3];
+	int64_t step_x[3];
+	int64_t step_y[3];
+	int64_t offsets[3][8];
+	int64_t lowest[3];
+	int64_t highest[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		row[i] = triangle.a[i] * start_x + triangle.b[i] * start_y + triangle.c[i];
+		step_x[i] = triangle.a[i] * sub_pixel_one;
+		step_y[i] = triangle.b[i] * sub_pixel_one;
+
+		lowest[i] = INT64_MAX;
+		highest[i] = INT64_MIN;
+		for (uint32_t s = 0; s < pattern.count; ++s)
+		{
+			offsets[i][s] = triangle.a[i] * pattern.x[s] + triangle.b[i] * pattern.y[s];
+			lowest[i] = std::min(lowest[i], offsets[i][s]);
+			highest[i] = std::max(highest[i], offsets[i][s]);
+		}
+	}
+	const uint32_t full = (1u << pattern.count) - 1;
+
+	for (int32_t y = min_y; y < max_y; ++y)
+	{
+		int64_t w0 = row[0];
+		int64_t w1 = row[1];
+		int64_t w2 = row[2];
+
+		for (int32_t x = min_x; x < max_x; ++x)
+		{
+			if (((w0 + highest[0]) | (w1 + highest[1]) | (w2 + highest[2])) >= 0)
+			{
+				uint32_t mask = full;
+				if (((w0 + lowest[0]) | (w1 + lowest[1]) | (w2 + lowest[2])) < 0)
+				{
+					mask = 0;
+					for (uint32_t s = 0; s < pattern.count; ++s)
+					{
+						if (((w0 + offsets[0][s]) | (w1 + offsets[1][s]) | (w2 + offsets[2][s])) >= 0) mask |= 1u << s;
+					}
+				}
+				if (mask) pixel(x, y, mask, (w0 | w1 | w2) >= 0);
+			}
+
+			w0 += step_x[0];
+			w1 += step_x[1];
+			w2 += step_x[2];
+		}
+
+		row[0] += step_y[0];
+		row[1] += step_y[1];
+		row[2] += step_y[2];
+	}
+}
@@ -1,108 +1,510 @@
 #include "renderer.h"
+
+#include <algorithm>
+
+#include "base_object.h"
 #include "engine_data.h"
+#include "pixel_kernels.h"
+#include "profiler.h"
 
 renderer::renderer(const uint32_t width, const uint32_t height, const uint32_t clear_color): width(width),
 	height(height),
-	clear_color_(clear_color)
+	chain_(width * height, clear_color),
+	pixels_(chain_.get_back_buffer()),
+	clear_color_(clear_color),
+	depth_(width, height, tile_size),
+	tiles_x_((width + tile_size - 1) / tile_size),
+	tiles_y_((height + tile_size - 1) / tile_size),
+	tile_active_(new uint8_t[get_tile_count()]),
+	bins_(new bin_list[get_tile_count()])
+{
+}
+
+void renderer::set_worker_count(const uint32_t worker_count)
+{
+	pool_.reset();
+
+	if (worker_count != 1)
+		pool_ = std::make_unique<tile_pool>(worker_count);
+}
+
+void renderer::set_incremental(const bool incremental)
+{
+	incremental_ = incremental;
+}
+
+bool renderer::set_sample_count(const uint32_t sample_count)
+{
+	if (sample_count != 1 && sample_count != 2 && sample_count != 4 && sample_count != 8) return false;
+
+	if (sample_count == 1) msaa_.reset();
+	else msaa_ = std::make_unique<msaa_target>(width, height, sample_count, tile_size);
+
+	invalidate();
+	return true;
+}
+
+void renderer::invalidate(const screen_rect& rect)
+{
+	const auto screen = get_screen_rect();
+	frame_damage_.add({
+		std::max(rect.min_x, screen.min_x), std::max(rect.min_y, screen.min_y), std::min(rect.max_x, screen.max_x),
+		std::min(rect.max_y, screen.max_y)
+	});
+}
+
+void renderer::invalidate()
 {
-	const auto size = get_screen_size() * sizeof pixels_;
-	pixels_ = new uint32_t[size];
+	frame_damage_.add(get_screen_rect());
+}
+
+void renderer::begin_frame()
+{
+	repair_full_ = true;
+	if (!incremental_) return;
 
-	for (uint32_t i = 0; i < size; i++)
+	// The back buffer holds frame content, it needs the damage of every frame after it up to this one.
+	const uint64_t frame = chain_.get_published_count() + 1;
+	const uint64_t content = chain_.get_back_sequence();
+	if (content == 0 || frame - content > history_size) return;
+
+	damage_region repair = frame_damage_;
+	for (auto sequence = content + 1; sequence < frame; ++sequence)
 	{
-		pixels_[i] = clear_color;
+		const auto slot = sequence % history_size;
+		if (history_sequences_[slot] != sequence) return;
+		repair.add(history_[slot]);
 	}
 
-	// Setup initial old pixel to match clear color for screen.
-	old_pixels_ = new uint32_t[size];
-	memcpy(old_pixels_, pixels_, size);
+	// Whole tiles, so binning can skip the others and clears and draws cover the same pixels.
+	repair.align(tile_size, width, height);
+	if (repair.get_area() == get_screen_size()) return;
+
+	repair_ = repair;
+	repair_full_ = false;
+
+	std::fill_n(tile_active_.get(), get_tile_count(), uint8_t{ 0 });
+	for (const auto& rect : repair_)
+	{
+		for (auto y = rect.min_y / tile_size; y * tile_size < static_cast<uint32_t>(rect.max_y); ++y)
+			for (auto x = rect.min_x / tile_size; x * tile_size < static_cast<uint32_t>(rect.max_x); ++x)
+				tile_active_[y * tiles_x_ + x] = 1;
+	}
 }
 
 void renderer::clear_buffer() const
 {
-	for (uint32_t i = 0; i < get_screen_size() * sizeof pixels_; i++)
+	LAB2_PROFILE_ZONE("clear_buffer");
+
+	if (msaa_)
+	{
+		if (repair_full_)
+		{
+			msaa_->clear(get_screen_rect(), clear_color_);
+			return;
+		}
+		for (const auto& rect : repair_) msaa_->clear(rect, clear_color_);
+		return;
+	}
+
+	if (repair_full_)
 	{
-		pixels_[i] = clear_color_;
+		pixel_kernels::get().fill(pixels_, clear_color_, get_screen_size());
+		return;
 	}
+
+	for (const auto& rect : repair_)
+	{
+		for (auto y = rect.min_y; y < rect.max_y; ++y)
+		{
+			pixel_kernels::get().fill(pixels_ + static_cast<size_t>(y) * width + rect.min_x, clear_color_,
+			                          static_cast<uint32_t>(rect.max_x - rect.min_x));
+		}
+	}
+}
+
+void renderer::clear_depth(const float depth) const
+{
+	LAB2_PROFILE_ZONE("clear_depth");
+
+	depth_.clear(depth);
+}
+
+void renderer::set_depth_state(const depth_compare compare, const bool write)
+{
+	depth_compare_ = compare;
+	depth_write_ = write;
+}
+
+void renderer::set_shading(const shading shade, const blend_mode blend)
+{
+	shading_ = shade;
+	blend_ = blend;
+}
+
+void renderer::set_texture(const texture* image, const texture_filter filter)
+{
+	resources_.image = image;
+	filter_ = filter;
+}
+
+render_state renderer::get_render_state() const
+{
+	render_state state;
+	state.compare = depth_compare_;
+	state.depth_write = depth_write_;
+	state.shade = shading_;
+	state.blend = blend_;
+	state.cull = cull_mode_;
+	state.image = resources_.image;
+	state.filter = filter_;
+	state.lines = line_mode_;
+	return state;
+}
+
+void renderer::set_render_state(const render_state& state)
+{
+	set_depth_state(state.compare, state.depth_write);
+	set_shading(state.shade, state.blend);
+	set_cull_mode(state.cull);
+	set_texture(state.image, state.filter);
+	set_line_mode(state.lines);
 }
 
 void renderer::draw_pixel(const uint32_t& pixel, const uint32_t x, const uint32_t y) const
 {
 	if (x >= width || y >= height) return;
+	if (!repair_full_ && !tile_active_[y / tile_size * tiles_x_ + x / tile_size]) return;
 
-	// Blend the old pixel with the new pixel.
-	const unsigned short alpha = ((pixel & 0xFF000000) >> 24) / 255;
-
+	// blend_pixel is exact for opaque and fully transparent pixels, no need to branch on alpha.
+	if (msaa_)
+	{
+		msaa_->write<blend_mode::alpha>(x, y, msaa_->get_full_mask(), pixel);
+		return;
+	}
 	auto& target = pixels_[y * width + x];
+	target = pixel_kernels::blend_pixel(target, pixel);
+}
+
+void renderer::draw_line(const vec2 start, const vec2 end, const uint32_t color) const
+{
+	LAB2_PROFILE_ZONE("draw_line");
+
+	line_setup line;
+	if (rasterizer::setup_line(line, start, end, color, width, height, line_mode_))
+		draw_line_setup(line);
+}
 
-	if (alpha <= 0)
+void renderer::draw_lines(const vec2* points, const uint32_t count, const uint32_t color) const
+{
+	LAB2_PROFILE_ZONE("draw_lines");
+
+	line_setup line;
+	for (uint32_t i = 0; i < count; ++i)
 	{
-		target ^= clear_color_;
-		return;
+		if (rasterizer::setup_line(line, points[i * 2], points[i * 2 + 1], color, width, height, line_mode_))
+			draw_line_setup(line);
 	}
+}
 
-	const auto new_red = math_helper::lerp_d((target & 0x00FF0000) >> 16, (pixel & 0x00FF0000) >> 16, alpha);
-	const auto new_green = math_helper::lerp_d((target & 0x0000FF00) >> 8, (pixel & 0x0000FF00) >> 8, alpha);
-	const auto new_blue = math_helper::lerp_d((target & 0x000000FF), pixel & 0x000000FF, alpha);
+void renderer::draw_triangles(const vertex* vertices, const uint32_t* indices, const uint32_t count) const
+{
+	LAB2_PROFILE_ZONE("draw_triangles");
 
-	const uint32_t red = math_helper::floor(new_red) << 16;
-	const uint32_t green = math_helper::floor(new_green) << 8;
-	const uint32_t blue = math_helper::floor(new_blue);
+	clear_bins(count);
 
-	target = alpha << 24 | red | green | blue;
+	// Setup every triangle once and bin it into the tiles its bounds touch.
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		setup_and_bin(vertices[indices[i * 3]], vertices[indices[i * 3 + 1]], vertices[indices[i * 3 + 2]]);
+	}
 
+	rasterize_bins();
 }
 
-void renderer::draw_line(const vec2 start, const vec2 end, const uint32_t color) const
+void renderer::draw_triangles(const soa_mesh& mesh, const uint32_t* indices, const uint32_t count) const
 {
-	// Get the points in x order.
-	vec2 min;
-	vec2 max;
-	math_helper::get_min_and_max_x(min, max, start, end);
+	LAB2_PROFILE_ZONE("draw_triangles");
+
+	clear_bins(count);
 
-	// Solve for zero distance lines.
-	if ((max - min).squared_magnitude() <= DEPSILON)
+	for (uint32_t i = 0; i < count; ++i)
 	{
-		draw_pixel(color, math_helper::floor(start.x), math_helper::floor(start.y));
+		setup_and_bin(mesh.get_vertex(indices[i * 3]), mesh.get_vertex(indices[i * 3 + 1]),
+		              mesh.get_vertex(indices[i * 3 + 2]));
 	}
 
-	// Solve for vertical lines
-	if (max.x - min.x <= DEPSILON)
+	rasterize_bins();
+}
+
+void renderer::draw_object(const base_object& object, const mat_4& view_projection) const
+{
+	draw_mesh(object.get_view(), view_projection * object.get_world_matrix());
+}
+
+void renderer::draw_mesh(const mesh_view& mesh, const mat_4& model_view_projection) const
+{
+	LAB2_PROFILE_ZONE("draw_mesh");
+
+	++geometry_stats_.objects;
+
+	const auto visibility = geometry_stage::classify(geometry_stage::get_frustum(model_view_projection), mesh.bounds);
+	if (visibility == cull_result::outside)
 	{
-		math_helper::get_min_and_max_y(min, max, start, end);
+		++geometry_stats_.objects_culled;
+		return;
+	}
 
-		for (uint32_t y = math_helper::floor(min.y); y < math_helper::floor(max.y); y++)
+	clipped_vertices_.clear();
+	clipped_indices_.clear();
+	geometry_stage::process(model_view_projection, mesh.vertices, mesh.indices, mesh.index_count / 3, width, height,
+	                        visibility == cull_result::intersecting, cull_mode_, clipped_vertices_, clipped_indices_,
+	                        geometry_stats_);
+
+	if (!clipped_indices_.empty())
+		draw_triangles(clipped_vertices_.data(), clipped_indices_.data(),
+		               static_cast<uint32_t>(clipped_indices_.size() / 3));
+}
+
+screen_rect renderer::get_screen_rect() const
+{
+	return { 0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height) };
+}
+
+void renderer::draw_line_setup(const line_setup& line) const
+{
+	const auto rasterize = [&](const line_setup& clipped)
+	{
+		if (!msaa_)
 		{
-			draw_pixel(color, math_helper::floor(min.x), y);
+			rasterizer::rasterize_line(clipped, pixels_, width);
+			return;
 		}
+
+		// Every sample of a pixel gets the line's coverage.
+		const uint32_t rgb = clipped.color & 0x00FFFFFF;
+		const uint32_t alpha = clipped.color >> 24;
+		const uint32_t full = msaa_->get_full_mask();
+		rasterizer::for_each_line_pixel(clipped, [&](const int32_t x, const int32_t y, const uint32_t coverage)
+		{
+			msaa_->write<blend_mode::alpha>(x, y, full, rgb | pixel_kernels::div_255(alpha * coverage) << 24);
+		});
+	};
+
+	if (repair_full_)
+	{
+		rasterize(line);
 		return;
 	}
 
-	// Solve for horizontal lines
-	if (max.y - min.y <= DEPSILON)
+	// The repair rectangles are disjoint, no pixel is drawn twice.
+	for (const auto& rect : repair_)
+	{
+		auto clipped = line;
+		if (rasterizer::clip_line(clipped, rect)) rasterize(clipped);
+	}
+}
+
+void renderer::clear_bins(const uint32_t count) const
+{
+	triangles_ = frame_arena_.allocate<triangle_setup>(count);
+	attributes_ = pixel_pipeline::get_attributes(shading_) != attribute_none
+		              ? frame_arena_.allocate<triangle_attributes>(count)
+		              : nullptr;
+	triangle_count_ = 0;
+
+	std::fill_n(bins_.get(), get_tile_count(), bin_list{ nullptr, nullptr });
+}
+
+void renderer::setup_and_bin(const vertex& v0, const vertex& v1, const vertex& v2) const
+{
+	triangle_setup triangle;
+	if (!rasterizer::setup_triangle(triangle, v0, v1, v2, width, height)) return;
+
+	// Kept parallel to triangles_ when the shading interpolates anything.
+	if (attributes_) rasterizer::setup_attributes(attributes_[triangle_count_], v0, v1, v2);
+
+	bin_triangle(triangle);
+}
+
+void renderer::bin_triangle(const triangle_setup& triangle) const
+{
+	const bool depth_test = depth_compare_ != depth_compare::always;
+	const auto index = triangle_count_++;
+	triangles_[index] = triangle;
+
+	const uint32_t first_x = triangle.bounds.min_x / tile_size;
+	const uint32_t first_y = triangle.bounds.min_y / tile_size;
+	const uint32_t last_x = (triangle.bounds.max_x - 1) / tile_size;
+	const uint32_t last_y = (triangle.bounds.max_y - 1) / tile_size;
+
+	for (uint32_t ty = first_y; ty <= last_y; ++ty)
+	{
+		for (uint32_t tx = first_x; tx <= last_x; ++tx)
+		{
+			const auto tile = ty * tiles_x_ + tx;
+			if (!repair_full_ && !tile_active_[tile]) continue;
+
+			// Earlier draws already bound the tile depths, and later writes can only make the test stricter.
+			if (depth_test && depth_.rejects(tile, depth_compare_, triangle.z_min, triangle.z_max)) continue;
+			if (!rasterizer::overlaps(triangle, get_tile_rect(tile), msaa_ ? &msaa_->get_pattern() : nullptr)) continue;
+
+			auto& bin = bins_[tile];
+			if (!bin.last || bin.last->count == bin_chunk::capacity)
+			{
+				auto* chunk = frame_arena_.allocate<bin_chunk>(1);
+				chunk->next = nullptr;
+				chunk->count = 0;
+				(bin.last ? bin.last->next : bin.first) = chunk;
+				bin.last = chunk;
+			}
+			bin.last->indices[bin.last->count++] = index;
+		}
+	}
+}
+
+void renderer::rasterize_bins() const
+{
+	// Draw state is constant for the call, pick the specialized pixel loops once. Flat shading with replace or
+	// alpha blends per triangle by its alpha, otherwise the blend mode is used for every pixel.
+	const bool flat = shading_ == shading::flat;
+	const bool per_triangle = flat && (blend_ == blend_mode::replace || blend_ == blend_mode::alpha);
+	const auto opaque_blend = per_triangle ? blend_mode::replace : blend_;
+	const auto translucent_blend = per_triangle ? blend_mode::alpha : blend_;
+	const auto shade = shading_ == shading::texture && !resources_.image ? shading::uv : shading_;
+	const auto opaque = pixel_pipeline::select(shade, opaque_blend, depth_compare_, depth_write_, filter_);
+	const auto translucent = pixel_pipeline::select(shade, translucent_blend, depth_compare_, depth_write_, filter_);
+	const bool interpolates = pixel_pipeline::get_attributes(shade) != attribute_none;
+	const triangle_attributes no_attributes{};
+
+	multisample_pipeline_function opaque_multisampled = nullptr;
+	multisample_pipeline_function translucent_multisampled = nullptr;
+	if (msaa_)
+	{
+		opaque_multisampled = pixel_pipeline::select_multisampled(shade, opaque_blend, depth_compare_, depth_write_,
+		                                                          filter_);
+		translucent_multisampled = pixel_pipeline::select_multisampled(shade, translucent_blend, depth_compare_,
+		                                                               depth_write_, filter_);
+	}
+
+	// Walk tile by tile so the pixels being filled stay in cache, submission order is kept per tile.
+	const auto rasterize_tile = [&](const uint32_t tile)
 	{
-		for (uint32_t x = math_helper::floor(min.x); x < math_helper::floor(max.x); ++x)
+		if (!bins_[tile].first) return;
+
+		LAB2_PROFILE_ZONE("rasterize_tile");
+		const auto rect = get_tile_rect(tile);
+
+		// Flat without depth fills whole spans.
+		if (flat && depth_compare_ == depth_compare::always && !depth_write_ && !msaa_)
+		{
+			for (auto* chunk = bins_[tile].first; chunk; chunk = chunk->next)
+			{
+				for (uint32_t i = 0; i < chunk->count; ++i)
+				{
+					rasterizer::rasterize(triangles_[chunk->indices[i]], rect, pixels_, width, translucent_blend);
+				}
+			}
+			return;
+		}
+
+		for (auto* chunk = bins_[tile].first; chunk; chunk = chunk->next)
 		{
-			draw_pixel(color, x, math_helper::floor(min.y));
+			for (uint32_t i = 0; i < chunk->count; ++i)
+			{
+				const auto index = chunk->indices[i];
+				const auto& triangle = triangles_[index];
+
+				if (depth_.rejects(tile, depth_compare_, triangle.z_min, triangle.z_max)) continue;
+
+				const auto& attributes = interpolates ? attributes_[index] : no_attributes;
+				const bool opaque_color = (triangle.color >> 24) == 0xFF;
+				if (msaa_)
+				{
+					const auto pipeline = opaque_color ? opaque_multisampled : translucent_multisampled;
+					if (!pipeline(triangle, attributes, resources_, rect, *msaa_, depth_.get_data(), width)) continue;
+				}
+				else
+				{
+					const auto pipeline = opaque_color ? opaque : translucent;
+					if (!pipeline(triangle, attributes, resources_, rect, pixels_, depth_.get_data(), width)) continue;
+				}
+
+				// A triangle spanning the whole tile may have covered it, the exact bounds can then tighten.
+				const auto& bounds = triangle.bounds;
+				if (bounds.min_x <= rect.min_x && bounds.min_y <= rect.min_y && bounds.max_x >= rect.max_x &&
+					bounds.max_y >= rect.max_y)
+					depth_.refresh_tile(tile);
+				else
+					depth_.note_write(tile, depth_compare_, triangle.z_min, triangle.z_max);
+			}
 		}
+	};
+
+	if (pool_)
+	{
+		pool_->run(get_tile_count(), rasterize_tile);
 		return;
 	}
 
-	// Solve for sloped lines.
-	for (uint32_t x = math_helper::floor(min.x); x < math_helper::floor(max.x); ++x)
+	for (uint32_t tile = 0; tile < get_tile_count(); ++tile)
 	{
-		// Generate the y value from x.
-		const auto y = math_helper::floor(math_helper::solve_line_2(x, start, end));
-		draw_pixel(color, x, y);
+		rasterize_tile(tile);
 	}
 }
 
-void renderer::update_frame() const
+screen_rect renderer::get_tile_rect(const uint32_t tile) const
 {
-	memcpy(old_pixels_, pixels_, get_screen_size() * sizeof pixels_);
+	const auto x = static_cast<int32_t>(tile % tiles_x_ * tile_size);
+	const auto y = static_cast<int32_t>(tile / tiles_x_ * tile_size);
+
+	return {
+		x, y,
+		std::min(x + static_cast<int32_t>(tile_size), static_cast<int32_t>(width)),
+		std::min(y + static_cast<int32_t>(tile_size), static_cast<int32_t>(height))
+	};
 }
 
-uint32_t* renderer::get_frame() const
+void renderer::update_frame()
 {
-	return old_pixels_;
+	// Without incremental frames anything may have been drawn anywhere.
+	damage_region damage;
+	if (incremental_) damage = frame_damage_;
+	else damage.add(get_screen_rect());
+
+	if (msaa_)
+	{
+		LAB2_PROFILE_ZONE("resolve");
+
+		// Only the tiles drawn this frame differ from what the back buffer holds.
+		const auto resolve_tile = [&](const uint32_t tile)
+		{
+			if (repair_full_ || tile_active_[tile]) msaa_->resolve(get_tile_rect(tile), pixels_, width);
+		};
+		if (pool_)
+		{
+			pool_->run(get_tile_count(), resolve_tile);
+		}
+		else
+		{
+			for (uint32_t tile = 0; tile < get_tile_count(); ++tile) resolve_tile(tile);
+		}
+	}
+
+	const auto sequence = chain_.get_published_count() + 1;
+	history_[sequence % history_size] = damage;
+	history_sequences_[sequence % history_size] = sequence;
+
+	pixels_ = chain_.publish(damage);
+
+	frame_damage_.clear();
+	repair_full_ = true;
+	frame_arena_.reset();
+}
+
+const uint32_t* renderer::get_frame()
+{
+	LAB2_PROFILE_ZONE("acquire_frame");
+
+	return chain_.acquire();
 }
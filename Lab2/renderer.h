@@ -1,32 +1,249 @@
 #pragma once
 #include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "depth_buffer.h"
+#include "frame_arena.h"
+#include "geometry_stage.h"
 #include "math_helper.h"
+#include "msaa_target.h"
+#include "pixel_pipeline.h"
+#include "rasterizer.h"
+#include "soa_mesh.h"
+#include "swap_chain.h"
+#include "tile_pool.h"
 
+class base_object;
 struct color;
 struct vec2;
+struct vertex;
+
+// Every setting that changes how draws come out, as one value.
+struct render_state
+{
+	depth_compare compare = depth_compare::always;
+	bool depth_write = false;
+	shading shade = shading::flat;
+	blend_mode blend = blend_mode::alpha;
+	cull_mode cull = cull_mode::none;
+	const texture* image = nullptr;
+	texture_filter filter = texture_filter::bilinear;
+	line_mode lines = line_mode::aliased;
+
+	friend bool operator==(const render_state& lhs, const render_state& rhs)
+	{
+		return lhs.compare == rhs.compare && lhs.depth_write == rhs.depth_write && lhs.shade == rhs.shade &&
+			lhs.blend == rhs.blend && lhs.cull == rhs.cull && lhs.image == rhs.image && lhs.filter == rhs.filter &&
+			lhs.lines == rhs.lines;
+	}
+
+	friend bool operator!=(const render_state& lhs, const render_state& rhs) { return !(lhs == rhs); }
+};
 
 class renderer
 {
 public:
 	renderer(const uint32_t width, const uint32_t height, const uint32_t clear_color);
 
+	// Threads tiles are rasterized on, one keeps everything on the calling thread and zero uses every core.
+	// Tiles own disjoint pixels and keep their submission order, so the frame is identical for any count.
+	void set_worker_count(const uint32_t worker_count);
+
+	uint32_t get_worker_count() const { return pool_ ? pool_->get_worker_count() : 1; }
+
 	const uint32_t width;
 	const uint32_t height;
 
+	// Incremental frames only redraw what changed. Off by default, then every frame is drawn whole.
+	// Per frame: invalidate what changes, begin_frame, clear and draw as usual, update_frame. Clears and
+	// draws then only touch the tiles that differ from what the back buffer still holds.
+	void set_incremental(const bool incremental);
+
+	// Samples per pixel, 1 (the default) draws single sampled. With 2, 4 or 8 draws go to a multisampled target
+	// that update_frame resolves into the frame, and triangle edges are anti-aliased. Pixels every draw covered
+	// whole keep one color. Lines and pixels cover every sample of their pixels. False for other counts,
+	// otherwise the whole screen is invalidated and has to be drawn again.
+	bool set_sample_count(const uint32_t sample_count);
+
+	uint32_t get_sample_count() const { return msaa_ ? msaa_->get_sample_count() : 1; }
+
+	// nullptr when single sampled.
+	const msaa_target* get_msaa_target() const { return msaa_.get(); }
+
+	// Marks an area as changed this frame, call before begin_frame.
+	void invalidate(const screen_rect& rect);
+
+	void invalidate();
+
+	// Limits clears and draws until update_frame to this frame's damage and that of the frames the back
+	// buffer missed. Falls back to the whole screen when it is not incremental or missed too many.
+	void begin_frame();
+
 	void clear_buffer() const;
 
+	void clear_depth(const float depth = 1.0f) const;
+
+	// Depth test of draw_triangles, vertex z is the depth. Off by default (always, no write), which keeps
+	// submission order. With a test on, tiles whose hierarchical-Z bounds fail it are skipped whole.
+	void set_depth_state(const depth_compare compare, const bool write);
+
+	const depth_buffer& get_depth_buffer() const { return depth_; }
+
+	// How draw_triangles colors pixels. Flat shading (the default) uses the first vertex color and, with replace
+	// or alpha, blends translucent triangles, the interpolating shadings and the premultiplied modes use blend for
+	// every pixel. Attributes are interpolated perspective correct using vertex w.
+	void set_shading(const shading shade, const blend_mode blend = blend_mode::alpha);
+
+	// Texture of texture shading, which falls back to uv shading without one. It has to outlive the draws.
+	void set_texture(const texture* image, const texture_filter filter = texture_filter::bilinear);
+
 	void draw_pixel(const uint32_t& pixel, const uint32_t x, const uint32_t y) const;
 
+	// How draw_line and draw_lines step, aliased by default. Smooth lines cover up to two pixels per step and
+	// blend them, one pixel wide lines without supersampling.
+	void set_line_mode(const line_mode mode) { line_mode_ = mode; }
+
+	// Lines are stepped in fixed point with 8 bit sub pixel precision and clipped to the screen first.
 	void draw_line(const vec2 start, const vec2 end, const uint32_t color = 0xFFFFFFFF) const;
 
-	void update_frame() const;
+	// Draws count lines, points holds the start and end of each line in turn.
+	void draw_lines(const vec2* points, const uint32_t count, const uint32_t color = 0xFFFFFFFF) const;
+
+	// Fills count indexed triangles, vertices are in screen space and colored by the shading state.
+	void draw_triangles(const vertex* vertices, const uint32_t* indices, const uint32_t count) const;
+
+	void draw_triangles(const soa_mesh& mesh, const uint32_t* indices, const uint32_t count) const;
+
+	// Draws the indexed triangles of an object through its world matrix and view_projection. Objects whose
+	// bounding sphere is outside the frustum are skipped whole, the rest are clipped to it before setup.
+	void draw_object(const base_object& object, const mat_4& view_projection) const;
+
+	// draw_object for geometry that is not a base_object, such as a mapped mesh file.
+	void draw_mesh(const mesh_view& mesh, const mat_4& model_view_projection) const;
+
+	// Faces draw_object drops by winding, none by default.
+	void set_cull_mode(const cull_mode cull) { cull_mode_ = cull; }
+
+	// Depth, shading, culling, texture and line state together, what command buffers record with every draw.
+	render_state get_render_state() const;
+
+	void set_render_state(const render_state& state);
+
+	const geometry_stats& get_geometry_stats() const { return geometry_stats_; }
 
-	uint32_t* get_frame() const;
+	void reset_geometry_stats() const { geometry_stats_ = geometry_stats(); }
+
+	// Publishes the finished frame to the presenter and moves on to the next back buffer, never blocks.
+	// Resolves the multisampled target first and resets the frame arena after.
+	void update_frame();
+
+	// Transient memory of the frame being drawn, released by update_frame. Triangle setup and bins live here,
+	// callers may put their own per-frame data in it too.
+	frame_arena& get_frame_arena() const { return frame_arena_; }
+
+	// Presenter side, waits for the newest published frame. It stays valid until the next call.
+	const uint32_t* get_frame();
+
+	// Render side, sequence number of the last published frame.
+	uint64_t get_published_count() const { return chain_.get_published_count(); }
+
+	// Presenter side, sequence number of the frame get_frame last returned.
+	uint64_t get_frame_sequence() const { return chain_.get_front_sequence(); }
+
+	// Presenter side, area of the frame get_frame last returned that changed since the previous one.
+	const damage_region& get_frame_damage() const { return chain_.get_front_damage(); }
 
 	uint32_t get_screen_size() const { return width * height; }
 
+	// Edge length of the square screen tiles triangles are binned into.
+	static constexpr uint32_t tile_size = 32;
+
+	uint32_t get_tile_count() const { return tiles_x_ * tiles_y_; }
+
+	screen_rect get_tile_rect(const uint32_t tile) const;
+
 private:
+	// Triangle indices of one tile, chained in arena sized chunks.
+	struct bin_chunk
+	{
+		static constexpr uint32_t capacity = 62;
+
+		bin_chunk* next;
+		uint32_t count;
+		uint32_t indices[capacity];
+	};
+
+	struct bin_list
+	{
+		bin_chunk* first;
+		bin_chunk* last;
+	};
+
+	screen_rect get_screen_rect() const;
+
+	// Draws a set up line, clipped to the repair region of an incremental frame.
+	void draw_line_setup(const line_setup& line) const;
+
+	// Takes room for up to count triangles from the frame arena and empties the bins.
+	void clear_bins(uint32_t count) const;
+
+	// Sets up a triangle and its attributes, then bins it.
+	void setup_and_bin(const vertex& v0, const vertex& v1, const vertex& v2) const;
+
+	// Queues a set up triangle on every tile it overlaps.
+	void bin_triangle(const triangle_setup& triangle) const;
+
+	// Rasterizes every binned triangle, on the tile pool when there is one.
+	void rasterize_bins() const;
+
+	swap_chain chain_;
 	uint32_t* pixels_;
-	uint32_t* old_pixels_;
 	const uint32_t clear_color_;
+
+	// Tiles write disjoint depths and hierarchical-Z entries, like pixels.
+	mutable depth_buffer depth_;
+	depth_compare depth_compare_ = depth_compare::always;
+	bool depth_write_ = false;
+
+	shading shading_ = shading::flat;
+	blend_mode blend_ = blend_mode::alpha;
+	cull_mode cull_mode_ = cull_mode::none;
+	pixel_resources resources_;
+	texture_filter filter_ = texture_filter::bilinear;
+	line_mode line_mode_ = line_mode::aliased;
+
+	const uint32_t tiles_x_;
+	const uint32_t tiles_y_;
+
+	// Incremental frame state, see begin_frame.
+	static constexpr uint32_t history_size = 4;
+	bool incremental_ = false;
+	damage_region frame_damage_;
+	damage_region history_[history_size];
+	uint64_t history_sequences_[history_size] = {};
+	damage_region repair_;
+	bool repair_full_ = true;
+	std::unique_ptr<uint8_t[]> tile_active_;
+
+	std::unique_ptr<tile_pool> pool_;
+
+	// Draws go here instead of the back buffer when multisampled, tiles write disjoint pixels and sample pools.
+	std::unique_ptr<msaa_target> msaa_;
+
+	mutable frame_arena frame_arena_;
+
+	// Setup and bins of the current draw_triangles call, in the frame arena.
+	mutable triangle_setup* triangles_ = nullptr;
+	mutable triangle_attributes* attributes_ = nullptr;
+	mutable uint32_t triangle_count_ = 0;
+
+	// One list per tile, reused by every draw so it stays in cache, the chunks come from the arena.
+	std::unique_ptr<bin_list[]> bins_;
+
+	// Scratch of draw_mesh, screen space output of the geometry stage. Its size is only known once a mesh is
+	// processed, so it grows in place and keeps its capacity between frames instead of living in the arena.
+	mutable std::vector<vertex> clipped_vertices_;
+	mutable std::vector<uint32_t> clipped_indices_;
+	mutable geometry_stats geometry_stats_;
 };
@@ -0,0 +1,141 @@
+#include "scene_graph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "base_object.h"
+
+uint32_t scene_graph::add_node(const uint32_t parent, const mat_4& relative_matrix, base_object* object)
+{
+	if (parent != no_parent && parent >= get_node_count()) throw std::out_of_range("Parent node does not exist");
+
+	const auto id = get_node_count();
+	const auto slot = static_cast<uint32_t>(ids_.size());
+
+	const auto parent_slot = parent == no_parent ? no_parent : slot_of_[parent];
+	const auto depth = parent == no_parent ? 0 : depths_[parent_slot] + 1;
+
+	// Appending keeps parents first, breadth first order only holds while depth does not decrease.
+	sorted_ = sorted_ && (depths_.empty() || depths_.back() <= depth);
+
+	parent_slots_.push_back(parent_slot);
+	relative_matrices_.push_back(relative_matrix);
+	world_matrices_.push_back(mat_4::identity());
+	dirty_.push_back(1);
+	objects_.push_back(object);
+	depths_.push_back(depth);
+	ids_.push_back(id);
+	slot_of_.push_back(slot);
+
+	if (object)
+	{
+		object->set_relative_matrix(relative_matrix);
+		if (parent != no_parent) object->set_parent(objects_[parent_slot]);
+	}
+
+	first_dirty_ = std::min(first_dirty_, slot);
+	return id;
+}
+
+uint32_t scene_graph::get_parent(const uint32_t node) const
+{
+	const auto parent_slot = parent_slots_[slot_of_[node]];
+	return parent_slot == no_parent ? no_parent : ids_[parent_slot];
+}
+
+const mat_4& scene_graph::get_relative_matrix(const uint32_t node) const
+{
+	return relative_matrices_[slot_of_[node]];
+}
+
+void scene_graph::set_relative_matrix(const uint32_t node, const mat_4& relative_matrix)
+{
+	const auto slot = slot_of_[node];
+
+	relative_matrices_[slot] = relative_matrix;
+	dirty_[slot] = 1;
+	first_dirty_ = std::min(first_dirty_, slot);
+
+	if (objects_[slot]) objects_[slot]->set_relative_matrix(relative_matrix);
+}
+
+const mat_4& scene_graph::get_world_matrix(const uint32_t node) const
+{
+	return world_matrices_[slot_of_[node]];
+}
+
+void scene_graph::update()
+{
+	updated_count_ = 0;
+	if (first_dirty_ >= ids_.size()) return;
+
+	if (!sorted_) sort();
+
+	const auto count = static_cast<uint32_t>(ids_.size());
+
+	// Parents come first, so a dirty parent has already passed its flag down by the time a child is reached.
+	for (uint32_t slot = first_dirty_; slot < count; ++slot)
+	{
+		const auto parent = parent_slots_[slot];
+		if (parent != no_parent) dirty_[slot] |= dirty_[parent];
+		if (!dirty_[slot]) continue;
+
+		world_matrices_[slot] = parent == no_parent
+			                        ? relative_matrices_[slot]
+			                        : world_matrices_[parent] * relative_matrices_[slot];
+
+		if (objects_[slot]) objects_[slot]->set_world_matrix(world_matrices_[slot]);
+		++updated_count_;
+	}
+
+	std::memset(dirty_.data() + first_dirty_, 0, count - first_dirty_);
+	first_dirty_ = UINT32_MAX;
+}
+
+void scene_graph::sort()
+{
+	const auto count = static_cast<uint32_t>(ids_.size());
+
+	// Counting sort by depth, stable so siblings keep their insertion order.
+	const auto max_depth = *std::max_element(depths_.begin(), depths_.end());
+	std::vector<uint32_t> offsets(max_depth + 2);
+	for (const auto depth : depths_) ++offsets[depth + 1];
+	for (uint32_t depth = 1; depth < offsets.size(); ++depth) offsets[depth] += offsets[depth - 1];
+
+	std::vector<uint32_t> new_slot(count);
+	for (uint32_t slot = 0; slot < count; ++slot) new_slot[slot] = offsets[depths_[slot]]++;
+
+	std::vector<uint32_t> parent_slots(count);
+	std::vector<mat_4> relative_matrices(count);
+	std::vector<mat_4> world_matrices(count);
+	std::vector<uint8_t> dirty(count);
+	std::vector<base_object*> objects(count);
+	std::vector<uint32_t> depths(count);
+	std::vector<uint32_t> ids(count);
+
+	first_dirty_ = UINT32_MAX;
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		const auto to = new_slot[slot];
+		parent_slots[to] = parent_slots_[slot] == no_parent ? no_parent : new_slot[parent_slots_[slot]];
+		relative_matrices[to] = relative_matrices_[slot];
+		world_matrices[to] = world_matrices_[slot];
+		dirty[to] = dirty_[slot];
+		objects[to] = objects_[slot];
+		depths[to] = depths_[slot];
+		ids[to] = ids_[slot];
+		slot_of_[ids_[slot]] = to;
+
+		if (dirty_[slot]) first_dirty_ = std::min(first_dirty_, to);
+	}
+
+	parent_slots_.swap(parent_slots);
+	relative_matrices_.swap(relative_matrices);
+	world_matrices_.swap(world_matrices);
+	dirty_.swap(dirty);
+	objects_.swap(objects);
+	depths_.swap(depths);
+	ids_.swap(ids);
+	sorted_ = true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "engine_data.h"
+
+class base_object;
+
+// Transform hierarchy kept in flat arrays in breadth first order, so every parent sits before its children.
+// Nodes are marked dirty when their relative matrix changes and update() recomputes
+// world = parent world * relative for them and their subtrees only, in one forward pass.
+class scene_graph
+{
+public:
+	static constexpr uint32_t no_parent = UINT32_MAX;
+
+	// Adds a node under parent (an id returned earlier, or no_parent for a root) and returns its id.
+	// The object, if any, receives the node's world matrix on every update that changes it.
+	uint32_t add_node(uint32_t parent, const mat_4& relative_matrix, base_object* object = nullptr);
+
+	uint32_t get_node_count() const { return static_cast<uint32_t>(slot_of_.size()); }
+
+	uint32_t get_parent(uint32_t node) const;
+
+	const mat_4& get_relative_matrix(uint32_t node) const;
+
+	void set_relative_matrix(uint32_t node, const mat_4& relative_matrix);
+
+	// World matrix as of the last update.
+	const mat_4& get_world_matrix(uint32_t node) const;
+
+	// Recomputes the world matrices of dirty nodes and their descendants.
+	void update();
+
+	// Nodes whose world matrix was recomputed by the last update.
+	uint32_t get_updated_count() const { return updated_count_; }
+
+private:
+	// Reorders the arrays breadth first after nodes were added.
+	void sort();
+
+	// Per slot arrays, in breadth first order.
+	std::vector<uint32_t> parent_slots_;
+	std::vector<mat_4> relative_matrices_;
+	std::vector<mat_4> world_matrices_;
+	std::vector<uint8_t> dirty_;
+	std::vector<base_object*> objects_;
+	std::vector<uint32_t> depths_;
+	std::vector<uint32_t> ids_;
+
+	// Node id to slot, ids stay stable when the arrays are reordered.
+	std::vector<uint32_t> slot_of_;
+
+	// Lowest dirty slot, nothing before it needs to be visited.
+	uint32_t first_dirty_ = UINT32_MAX;
+	uint32_t updated_count_ = 0;
+	bool sorted_ = true;
+};
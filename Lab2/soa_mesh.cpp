@@ -0,0 +1,252 @@
+#include "soa_mesh.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include "cpu_features.h"
+#include "engine_data.h"
+#include "math_core.h"
+
+#ifdef LAB2_SSE2
+#include <immintrin.h>
+#endif
+
+static float* allocate_streams(const size_t bytes)
+{
+#ifdef _MSC_VER
+	void* memory = _aligned_malloc(bytes, soa_mesh::alignment);
+#else
+	void* memory = std::aligned_alloc(soa_mesh::alignment, bytes);
+#endif
+	if (!memory) throw std::bad_alloc();
+
+	std::memset(memory, 0, bytes);
+	return static_cast<float*>(memory);
+}
+
+static void free_streams(float* memory)
+{
+#ifdef _MSC_VER
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+soa_mesh::soa_mesh(const uint32_t vertex_count)
+{
+	resize(vertex_count);
+}
+
+soa_mesh::soa_mesh(const vertex* vertices, const uint32_t vertex_count)
+{
+	resize(vertex_count);
+
+	for (uint32_t i = 0; i < vertex_count; ++i)
+	{
+		set_vertex(i, vertices[i]);
+	}
+}
+
+soa_mesh::~soa_mesh()
+{
+	free_streams(data_);
+}
+
+soa_mesh::soa_mesh(const soa_mesh& other)
+{
+	*this = other;
+}
+
+soa_mesh::soa_mesh(soa_mesh&& other) noexcept: data_(other.data_),
+                                              size_(other.size_),
+                                              capacity_(other.capacity_)
+{
+	other.data_ = nullptr;
+	other.size_ = 0;
+	other.capacity_ = 0;
+}
+
+soa_mesh& soa_mesh::operator=(const soa_mesh& other)
+{
+	if (this == &other)
+		return *this;
+
+	free_streams(data_);
+	data_ = nullptr;
+	size_ = 0;
+	capacity_ = 0;
+
+	if (other.data_)
+	{
+		data_ = allocate_streams(static_cast<size_t>(other.capacity_) * stream_count * sizeof(float));
+		std::memcpy(data_, other.data_, static_cast<size_t>(other.capacity_) * stream_count * sizeof(float));
+		size_ = other.size_;
+		capacity_ = other.capacity_;
+	}
+	return *this;
+}
+
+soa_mesh& soa_mesh::operator=(soa_mesh&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	std::swap(data_, other.data_);
+	std::swap(size_, other.size_);
+	std::swap(capacity_, other.capacity_);
+	return *this;
+}
+
+void soa_mesh::resize(const uint32_t vertex_count)
+{
+	const uint32_t capacity = (vertex_count + block - 1) / block * block;
+
+	if (capacity != capacity_)
+	{
+		float* data = capacity ? allocate_streams(static_cast<size_t>(capacity) * stream_count * sizeof(float)) : nullptr;
+
+		// Streams start at a multiple of the capacity, so each one moves separately.
+		const auto kept = std::min(size_, vertex_count);
+		for (uint32_t i = 0; data_ && data && i < stream_count; ++i)
+		{
+			std::memcpy(data + static_cast<size_t>(i) * capacity, stream(i), kept * sizeof(float));
+		}
+
+		free_streams(data_);
+		data_ = data;
+		capacity_ = capacity;
+	}
+	else if (vertex_count < size_)
+	{
+		for (uint32_t i = 0; i < stream_count; ++i)
+		{
+			std::memset(stream(i) + vertex_count, 0, (size_ - vertex_count) * sizeof(float));
+		}
+	}
+
+	size_ = vertex_count;
+}
+
+vertex soa_mesh::get_vertex(const uint32_t index) const
+{
+	return vertex(x()[index], y()[index], z()[index], w()[index], color(colors()[index]), u()[index], v()[index]);
+}
+
+void soa_mesh::set_vertex(const uint32_t index, const vertex& v) const
+{
+	x()[index] = static_cast<float>(v.x);
+	y()[index] = static_cast<float>(v.y);
+	z()[index] = static_cast<float>(v.z);
+	w()[index] = static_cast<float>(v.w);
+	colors()[index] = v.color.convert();
+	u()[index] = static_cast<float>(v.u);
+	this->v()[index] = static_cast<float>(v.v);
+}
+
+#pragma region transform kernels
+
+static void transform_scalar(const mat4f& m, const soa_mesh& in, const soa_mesh& out)
+{
+	const float* x = in.x();
+	const float* y = in.y();
+	const float* z = in.z();
+	const float* w = in.w();
+	float* streams[4] = { out.x(), out.y(), out.z(), out.w() };
+
+	for (uint32_t i = 0; i < in.size(); ++i)
+	{
+		const float vx = x[i], vy = y[i], vz = z[i], vw = w[i];
+		for (int r = 0; r < 4; ++r)
+		{
+			streams[r][i] = m[r][0] * vx + m[r][1] * vy + m[r][2] * vz + m[r][3] * vw;
+		}
+	}
+}
+
+#ifdef LAB2_SSE2
+
+static void transform_sse2(const mat4f& m, const soa_mesh& in, const soa_mesh& out)
+{
+	__m128 c[4][4];
+	for (int r = 0; r < 4; ++r)
+		for (int k = 0; k < 4; ++k)
+			c[r][k] = _mm_set1_ps(m[r][k]);
+
+	float* streams[4] = { out.x(), out.y(), out.z(), out.w() };
+
+	// Padding lanes are transformed too, the streams are allocated to whole blocks.
+	for (uint32_t i = 0; i < in.size(); i += 4)
+	{
+		const __m128 vx = _mm_load_ps(in.x() + i);
+		const __m128 vy = _mm_load_ps(in.y() + i);
+		const __m128 vz = _mm_load_ps(in.z() + i);
+		const __m128 vw = _mm_load_ps(in.w() + i);
+
+		for (int r = 0; r < 4; ++r)
+		{
+			const __m128 xy = _mm_add_ps(_mm_mul_ps(c[r][0], vx), _mm_mul_ps(c[r][1], vy));
+			const __m128 zw = _mm_add_ps(_mm_mul_ps(c[r][2], vz), _mm_mul_ps(c[r][3], vw));
+			_mm_store_ps(streams[r] + i, _mm_add_ps(xy, zw));
+		}
+	}
+}
+
+LAB2_TARGET_AVX2 static void transform_avx2(const mat4f& m, const soa_mesh& in, const soa_mesh& out)
+{
+	float* streams[4] = { out.x(), out.y(), out.z(), out.w() };
+
+	for (uint32_t i = 0; i < in.size(); i += 8)
+	{
+		const __m256 vx = _mm256_load_ps(in.x() + i);
+		const __m256 vy = _mm256_load_ps(in.y() + i);
+		const __m256 vz = _mm256_load_ps(in.z() + i);
+		const __m256 vw = _mm256_load_ps(in.w() + i);
+
+		for (int r = 0; r < 4; ++r)
+		{
+			__m256 result = _mm256_mul_ps(_mm256_set1_ps(m[r][3]), vw);
+			result = _mm256_fmadd_ps(_mm256_set1_ps(m[r][2]), vz, result);
+			result = _mm256_fmadd_ps(_mm256_set1_ps(m[r][1]), vy, result);
+			result = _mm256_fmadd_ps(_mm256_set1_ps(m[r][0]), vx, result);
+			_mm256_store_ps(streams[r] + i, result);
+		}
+	}
+}
+
+#endif
+
+using transform_kernel = void (*)(const mat4f&, const soa_mesh&, const soa_mesh&);
+
+static transform_kernel select_transform()
+{
+#ifdef LAB2_SSE2
+	const auto& features = cpu_features::get();
+	if (features.avx2 && features.fma) return transform_avx2;
+	if (features.sse2) return transform_sse2;
+#endif
+	return transform_scalar;
+}
+
+#pragma endregion
+
+void soa_mesh::transform(const mat_4& matrix, const soa_mesh& in, soa_mesh& out)
+{
+	if (&in != &out) out.resize(in.size());
+	if (in.size() == 0) return;
+
+	const auto m = to_mat<float>(matrix);
+
+	static const transform_kernel kernel = select_transform();
+	kernel(m, in, out);
+
+	if (&in != &out)
+	{
+		std::memcpy(out.colors(), in.colors(), in.size() * sizeof(uint32_t));
+		std::memcpy(out.u(), in.u(), in.size() * sizeof(float));
+		std::memcpy(out.v(), in.v(), in.size() * sizeof(float));
+	}
+}
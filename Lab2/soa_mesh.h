@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+struct mat_4;
+struct vertex;
+
+// Vertices stored as separate x, y, z, w, packed color and u, v streams.
+// Every stream starts 32 byte aligned and is padded to a multiple of 8 entries,
+// so kernels can run whole 4 or 8 wide blocks without a scalar tail.
+class soa_mesh
+{
+public:
+	static constexpr uint32_t alignment = 32;
+	static constexpr uint32_t block = 8;
+
+	soa_mesh() = default;
+
+	explicit soa_mesh(uint32_t vertex_count);
+
+	soa_mesh(const vertex* vertices, uint32_t vertex_count);
+
+	~soa_mesh();
+
+	soa_mesh(const soa_mesh& other);
+
+	soa_mesh(soa_mesh&& other) noexcept;
+
+	soa_mesh& operator=(const soa_mesh& other);
+
+	soa_mesh& operator=(soa_mesh&& other) noexcept;
+
+	// Existing vertices are kept, new ones are zero.
+	void resize(uint32_t vertex_count);
+
+	uint32_t size() const { return size_; }
+
+	// Entries allocated per stream, size rounded up to a whole block.
+	uint32_t capacity() const { return capacity_; }
+
+	float* x() const { return stream(0); }
+	float* y() const { return stream(1); }
+	float* z() const { return stream(2); }
+	float* w() const { return stream(3); }
+	uint32_t* colors() const { return reinterpret_cast<uint32_t*>(stream(4)); }
+	float* u() const { return stream(5); }
+	float* v() const { return stream(6); }
+
+	vertex get_vertex(uint32_t index) const;
+
+	void set_vertex(uint32_t index, const vertex& v) const;
+
+	// Transforms every position of in by matrix into out, colors and texture coordinates are copied through.
+	// out is resized to match, in and out may be the same mesh.
+	static void transform(const mat_4& matrix, const soa_mesh& in, soa_mesh& out);
+
+private:
+	float* stream(const uint32_t index) const { return data_ + static_cast<size_t>(index) * capacity_; }
+
+	static constexpr uint32_t stream_count = 7;
+
+	float* data_ = nullptr;
+	uint32_t size_ = 0;
+	uint32_t capacity_ = 0;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+
+// A presentation target for the RasterSurface api.
+// RS_Initialize, RS_Update and RS_Shutdown forward to the active backend.
+class surface_backend
+{
+public:
+	virtual ~surface_backend() = default;
+
+	// Creates whatever the backend presents into, a window, a file or a ring of frames.
+	virtual bool initialize(const char* title, uint32_t width, uint32_t height) = 0;
+
+	// Presents one frame, returns false once the backend no longer accepts frames.
+	// pixels are only borrowed for the duration of the call.
+	virtual bool update(const uint32_t* pixels, uint32_t pixel_count) = 0;
+
+	// Presents a frame of which only rects changed, four edges per rectangle as in RS_UpdateRegion.
+	// Backends that keep the previous frame can copy just those, the default presents everything.
+	virtual bool update_region(const uint32_t* pixels, const uint32_t pixel_count, const uint32_t* rects,
+	                           const uint32_t rect_count)
+	{
+		(void)rects;
+		(void)rect_count;
+		return update(pixels, pixel_count);
+	}
+
+	// Releases everything created by initialize.
+	virtual bool shutdown() = 0;
+};
@@ -0,0 +1,45 @@
+#include "swap_chain.h"
+
+#include "pixel_kernels.h"
+
+swap_chain::swap_chain(const uint32_t pixel_count, const uint32_t clear_color): pixel_count_(pixel_count)
+{
+	for (auto& buffer : buffers_)
+	{
+		buffer.reset(new uint32_t[pixel_count]);
+		pixel_kernels::get().fill(buffer.get(), clear_color, pixel_count);
+	}
+}
+
+uint32_t* swap_chain::publish(const damage_region& damage)
+{
+	sequences_[back_] = published_.load(std::memory_order_relaxed) + 1;
+
+	// The frame and its damage change hands together, so an acquire takes exactly the damage of the frames
+	// published up to the one it receives. Holding the lock also orders the notify after a presenter that is
+	// about to sleep.
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		pending_damage_.add(damage);
+		const auto previous = ready_.exchange(back_ | fresh_bit, std::memory_order_acq_rel);
+		back_ = previous & index_mask;
+	}
+	published_.fetch_add(1, std::memory_order_relaxed);
+	frame_ready_.notify_one();
+
+	return get_back_buffer();
+}
+
+const uint32_t* swap_chain::acquire()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	frame_ready_.wait(lock, [this]() { return (ready_.load(std::memory_order_acquire) & fresh_bit) != 0; });
+
+	const auto previous = ready_.exchange(front_, std::memory_order_acq_rel);
+	front_ = previous & index_mask;
+
+	front_damage_ = pending_damage_;
+	pending_damage_.clear();
+
+	return buffers_[front_].get();
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "damage_region.h"
+
+// Three frame buffers shared by the render thread and the presenter.
+// The renderer owns the back buffer and the presenter the front buffer, the third holds the
+// newest finished frame. Publishing and acquiring swap buffer indices, pixels are never copied.
+class swap_chain
+{
+public:
+	swap_chain(uint32_t pixel_count, uint32_t clear_color);
+
+	swap_chain(const swap_chain& other) = delete;
+
+	swap_chain& operator=(const swap_chain& other) = delete;
+
+	uint32_t get_pixel_count() const { return pixel_count_; }
+
+	// Render thread, the buffer being drawn.
+	uint32_t* get_back_buffer() const { return buffers_[back_].get(); }
+
+	// Render thread, hands the back buffer over as the newest frame and returns the next one to draw.
+	// Never waits for the presenter, an unpresented frame is simply replaced. damage is the area that
+	// changed since the previous frame.
+	uint32_t* publish(const damage_region& damage);
+
+	// Render thread, sequence number of the frame the back buffer last held, zero if it never held one.
+	uint64_t get_back_sequence() const { return sequences_[back_]; }
+
+	// Presenter, takes the newest published frame, waiting until one is published.
+	// The frame stays untouched until the next acquire.
+	const uint32_t* acquire();
+
+	// Frames published since construction, also the sequence number of the newest one.
+	uint64_t get_published_count() const { return published_.load(std::memory_order_relaxed); }
+
+	// Presenter, sequence number of the frame returned by the last acquire, zero before the first.
+	uint64_t get_front_sequence() const { return sequences_[front_]; }
+
+	// Presenter, area that changed between the frame returned by the previous acquire and the last one,
+	// including every frame skipped in between.
+	const damage_region& get_front_damage() const { return front_damage_; }
+
+private:
+	// ready_ holds the index of the newest frame, fresh_bit is set until the presenter takes it.
+	static constexpr uint32_t fresh_bit = 4;
+	static constexpr uint32_t index_mask = 3;
+
+	const uint32_t pixel_count_;
+	std::unique_ptr<uint32_t[]> buffers_[3];
+	// Written with the pixels and handed over by the same exchange.
+	uint64_t sequences_[3] = {};
+
+	uint32_t back_ = 0;
+	std::atomic<uint32_t> ready_{ 1 };
+	uint32_t front_ = 2;
+
+	std::atomic<uint64_t> published_{ 0 };
+
+	// Damage of the frames published since the presenter last acquired. It is updated with the exchange of
+	// ready_ under mutex_, so it always matches the frame a presenter would take next.
+	damage_region pending_damage_;
+	damage_region front_damage_;
+
+	// Sleeps the presenter while no frame is pending and guards the handoff of frames with their damage.
+	std::mutex mutex_;
+	std::condition_variable frame_ready_;
+};
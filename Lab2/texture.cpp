@@ -0,0 +1,104 @@
+#include "texture.h"
+
+#include <algorithm>
+
+// Spreads the low 16 bits of value to the even bits.
+static uint32_t spread_bits(uint32_t value)
+{
+	value &= 0x0000FFFF;
+	value = (value | value << 8) & 0x00FF00FF;
+	value = (value | value << 4) & 0x0F0F0F0F;
+	value = (value | value << 2) & 0x33333333;
+	value = (value | value << 1) & 0x55555555;
+	return value;
+}
+
+static uint32_t log2_of_power(const uint32_t value)
+{
+	uint32_t bits = 0;
+	while ((1u << bits) < value) ++bits;
+	return bits;
+}
+
+// Averages 2 or 4 texels per channel, rounding to nearest.
+static uint32_t average(const uint32_t* texels, const uint32_t count)
+{
+	uint32_t result = 0;
+	for (uint32_t shift = 0; shift < 32; shift += 8)
+	{
+		uint32_t sum = count / 2;
+		for (uint32_t i = 0; i < count; ++i) sum += texels[i] >> shift & 0xFF;
+		result |= sum / count << shift;
+	}
+	return result;
+}
+
+bool texture::create(const uint32_t* texels, const uint32_t width, const uint32_t height, const texture_layout layout,
+                     const bool mips)
+{
+	if (width == 0 || height == 0 || (width & (width - 1)) || (height & (height - 1))) return false;
+
+	layout_ = layout;
+	levels_.clear();
+	offsets_.clear();
+
+	// Sizes and offset tables of every level first.
+	uint32_t texel_count = 0;
+	for (uint32_t w = width, h = height;; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u))
+	{
+		level l{ w, h, texel_count, static_cast<uint32_t>(offsets_.size()), static_cast<uint32_t>(offsets_.size() + w) };
+		levels_.push_back(l);
+		texel_count += w * h;
+
+		// Morton interleaves the bits both sizes have, the larger size keeps its remaining bits on top.
+		const uint32_t x_bits = log2_of_power(w), y_bits = log2_of_power(h);
+		const uint32_t shared = std::min(x_bits, y_bits);
+		for (uint32_t x = 0; x < w; ++x)
+		{
+			offsets_.push_back(layout == texture_layout::linear
+				                   ? x
+				                   : spread_bits(x & ((1u << shared) - 1)) | (x >> shared) << (2 * shared));
+		}
+		for (uint32_t y = 0; y < h; ++y)
+		{
+			offsets_.push_back(layout == texture_layout::linear
+				                   ? y * w
+				                   : spread_bits(y & ((1u << shared) - 1)) << 1 | (y >> shared) << (2 * shared));
+		}
+
+		if (!mips || (w == 1 && h == 1)) break;
+	}
+	texels_.assign(texel_count, 0);
+
+	// Each level is filtered from the previous one in row order, then stored in the layout.
+	std::vector<uint32_t> current(texels, texels + static_cast<size_t>(width) * height);
+	std::vector<uint32_t> next;
+	for (uint32_t i = 0; i < levels_.size(); ++i)
+	{
+		const auto& l = levels_[i];
+		for (uint32_t y = 0; y < l.height; ++y)
+			for (uint32_t x = 0; x < l.width; ++x)
+				texels_[l.offset + offsets_[l.x_offsets + x] + offsets_[l.y_offsets + y]] = current[y * l.width + x];
+
+		if (i + 1 == levels_.size()) break;
+
+		const auto& smaller = levels_[i + 1];
+		const uint32_t step_x = l.width / smaller.width, step_y = l.height / smaller.height;
+		next.resize(smaller.width * smaller.height);
+		for (uint32_t y = 0; y < smaller.height; ++y)
+		{
+			for (uint32_t x = 0; x < smaller.width; ++x)
+			{
+				uint32_t block[4];
+				uint32_t count = 0;
+				for (uint32_t dy = 0; dy < step_y; ++dy)
+					for (uint32_t dx = 0; dx < step_x; ++dx)
+						block[count++] = current[(y * step_y + dy) * l.width + x * step_x + dx];
+				next[y * smaller.width + x] = average(block, count);
+			}
+		}
+		current.swap(next);
+	}
+
+	return true;
+}
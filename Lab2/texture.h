@@ -0,0 +1,139 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+enum class texture_filter
+{
+	nearest,
+	// Weighs the four nearest texels, with 8 bit weights.
+	bilinear
+};
+
+// Order of the texels of a level in memory.
+enum class texture_layout
+{
+	// Row by row.
+	linear,
+	// Z-order, x and y bits interleaved, so texels close in 2D are close in memory in every direction.
+	morton
+};
+
+// A 32 bit ARGB image with its mip chain, both sizes powers of two. Coordinates wrap, 0 to 1 covers the image
+// once and texel centers sit at half texels.
+class texture
+{
+public:
+	// Copies width x height texels given row by row, with mips the chain down to 1 x 1 is built by averaging
+	// 2 x 2 blocks. False when a size is zero or not a power of two.
+	bool create(const uint32_t* texels, uint32_t width, uint32_t height, texture_layout layout = texture_layout::morton,
+	             bool mips = true);
+
+	uint32_t get_width(const uint32_t level = 0) const { return levels_[level].width; }
+
+	uint32_t get_height(const uint32_t level = 0) const { return levels_[level].height; }
+
+	uint32_t get_level_count() const { return static_cast<uint32_t>(levels_.size()); }
+
+	texture_layout get_layout() const { return layout_; }
+
+	// Texel of a level, x and y have to be inside it.
+	uint32_t fetch(const uint32_t x, const uint32_t y, const uint32_t level = 0) const
+	{
+		const auto& l = levels_[level];
+		return texels_[l.offset + offsets_[l.x_offsets + x] + offsets_[l.y_offsets + y]];
+	}
+
+	// Mip level to sample from the screen space derivatives of u and v, zero or less magnifies level 0.
+	float get_lod(const float du_dx, const float dv_dx, const float du_dy, const float dv_dy) const
+	{
+		const auto w = static_cast<float>(levels_[0].width), h = static_cast<float>(levels_[0].height);
+
+		// Texels crossed per pixel along the steeper screen axis.
+		const float x_squared = du_dx * du_dx * w * w + dv_dx * dv_dx * h * h;
+		const float y_squared = du_dy * du_dy * w * w + dv_dy * dv_dy * h * h;
+		const float squared = x_squared > y_squared ? x_squared : y_squared;
+
+		return squared > 0 ? 0.5f * fast_log2(squared) : 0.0f;
+	}
+
+	uint32_t sample_nearest(const float u, const float v, const uint32_t level = 0) const
+	{
+		const auto& l = levels_[level];
+		const auto x = static_cast<uint32_t>(floor_to_int(u * static_cast<float>(l.width))) & (l.width - 1);
+		const auto y = static_cast<uint32_t>(floor_to_int(v * static_cast<float>(l.height))) & (l.height - 1);
+		return fetch(x, y, level);
+	}
+
+	uint32_t sample_bilinear(const float u, const float v, const uint32_t level = 0) const
+	{
+		const auto& l = levels_[level];
+		const float x = u * static_cast<float>(l.width) - 0.5f;
+		const float y = v * static_cast<float>(l.height) - 0.5f;
+		const int32_t floor_x = floor_to_int(x), floor_y = floor_to_int(y);
+
+		const auto weight_x = static_cast<uint32_t>((x - static_cast<float>(floor_x)) * 256.0f + 0.5f);
+		const auto weight_y = static_cast<uint32_t>((y - static_cast<float>(floor_y)) * 256.0f + 0.5f);
+
+		const uint32_t x0 = static_cast<uint32_t>(floor_x) & (l.width - 1);
+		const uint32_t y0 = static_cast<uint32_t>(floor_y) & (l.height - 1);
+		const uint32_t x1 = (x0 + 1) & (l.width - 1);
+		const uint32_t y1 = (y0 + 1) & (l.height - 1);
+
+		const uint32_t top = lerp_texels(fetch(x0, y0, level), fetch(x1, y0, level), weight_x);
+		const uint32_t bottom = lerp_texels(fetch(x0, y1, level), fetch(x1, y1, level), weight_x);
+		return lerp_texels(top, bottom, weight_y);
+	}
+
+	// Filters the level nearest to lod.
+	uint32_t sample(const float u, const float v, const float lod, const texture_filter filter) const
+	{
+		const auto last = static_cast<int32_t>(levels_.size()) - 1;
+		const int32_t rounded = floor_to_int(lod + 0.5f);
+		const auto level = static_cast<uint32_t>(rounded < 0 ? 0 : rounded > last ? last : rounded);
+		return filter == texture_filter::bilinear ? sample_bilinear(u, v, level) : sample_nearest(u, v, level);
+	}
+
+private:
+	// std::floor is a library call without SSE4.1, this is a compare.
+	static int32_t floor_to_int(const float value)
+	{
+		const auto truncated = static_cast<int32_t>(value);
+		return truncated - (value < static_cast<float>(truncated) ? 1 : 0);
+	}
+
+	// Approximate log2, exact at powers of two and within 0.09 between them, which is plenty to pick a mip.
+	static float fast_log2(const float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return static_cast<float>(bits) * (1.0f / (1 << 23)) - 127.0f;
+	}
+
+	// a + (b - a) * weight / 256 for every channel, weight from 0 to 256.
+	static uint32_t lerp_texels(const uint32_t a, const uint32_t b, const uint32_t weight)
+	{
+		const uint32_t inverse = 256 - weight;
+		const uint32_t rb = ((a & 0x00FF00FF) * inverse + (b & 0x00FF00FF) * weight) >> 8 & 0x00FF00FF;
+		const uint32_t ag = ((a >> 8 & 0x00FF00FF) * inverse + (b >> 8 & 0x00FF00FF) * weight) & 0xFF00FF00;
+		return ag | rb;
+	}
+
+	struct level
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t offset;
+
+		// Where the level's offset tables start in offsets_, one entry per column and one per row.
+		uint32_t x_offsets;
+		uint32_t y_offsets;
+	};
+
+	std::vector<uint32_t> texels_;
+
+	// Texel index of a level is its column entry plus its row entry, which hides the layout from fetch.
+	std::vector<uint32_t> offsets_;
+	std::vector<level> levels_;
+	texture_layout layout_ = texture_layout::morton;
+};
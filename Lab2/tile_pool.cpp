@@ -0,0 +1,104 @@
+#include "tile_pool.h"
+
+#include <algorithm>
+
+#include "profiler.h"
+
+tile_pool::tile_pool(const uint32_t worker_count):
+	worker_count_(worker_count ? worker_count : std::max(1u, std::thread::hardware_concurrency())),
+	slices_(new slice[worker_count_])
+{
+	// The thread calling run is worker zero.
+	for (uint32_t i = 1; i < worker_count_; ++i)
+	{
+		threads_.emplace_back(&tile_pool::worker_loop, this, i);
+	}
+}
+
+tile_pool::~tile_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		exit_ = true;
+	}
+	start_.notify_all();
+
+	for (auto& thread : threads_) thread.join();
+}
+
+void tile_pool::run(const uint32_t job_count, const std::function<void(uint32_t)>& job)
+{
+	if (job_count == 0) return;
+
+	// Nothing to share with, skip the handshake.
+	if (worker_count_ == 1)
+	{
+		for (uint32_t i = 0; i < job_count; ++i) job(i);
+		return;
+	}
+
+	// Split the batch into even contiguous slices, neighbouring tiles stay on one thread.
+	for (uint32_t i = 0; i < worker_count_; ++i)
+	{
+		slices_[i].next.store(static_cast<uint32_t>(static_cast<uint64_t>(job_count) * i / worker_count_),
+		                      std::memory_order_relaxed);
+		slices_[i].end = static_cast<uint32_t>(static_cast<uint64_t>(job_count) * (i + 1) / worker_count_);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		job_ = &job;
+		busy_ = worker_count_ - 1;
+		++generation_;
+	}
+	start_.notify_all();
+
+	work(0);
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	finished_.wait(lock, [this]() { return busy_ == 0; });
+	job_ = nullptr;
+}
+
+void tile_pool::work(const uint32_t worker)
+{
+	const auto& job = *job_;
+
+	// Drain our own slice first, then steal from the others in order.
+	for (uint32_t i = 0; i < worker_count_; ++i)
+	{
+		auto& victim = slices_[(worker + i) % worker_count_];
+
+		for (;;)
+		{
+			const auto index = victim.next.fetch_add(1, std::memory_order_relaxed);
+			if (index >= victim.end) break;
+
+			job(index);
+		}
+	}
+}
+
+void tile_pool::worker_loop(const uint32_t worker)
+{
+	profiler::set_thread_name("tile_worker");
+	uint64_t seen = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			start_.wait(lock, [&]() { return exit_ || generation_ != seen; });
+			if (exit_) return;
+			seen = generation_;
+		}
+
+		work(worker);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			--busy_;
+		}
+		finished_.notify_one();
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a batch of independent jobs (screen tiles) across a fixed set of threads.
+// Every worker starts on its own contiguous slice of the batch and steals from
+// the other slices once it runs dry, so no job is ever run twice or skipped.
+class tile_pool
+{
+public:
+	// worker_count includes the calling thread, zero uses every hardware thread.
+	explicit tile_pool(uint32_t worker_count = 0);
+
+	~tile_pool();
+
+	tile_pool(const tile_pool& other) = delete;
+
+	tile_pool& operator=(const tile_pool& other) = delete;
+
+	uint32_t get_worker_count() const { return worker_count_; }
+
+	// Calls job(index) for every index below job_count and returns once all have finished.
+	void run(uint32_t job_count, const std::function<void(uint32_t)>& job);
+
+private:
+	// A worker's slice of the batch, padded so slices never share a cache line.
+	struct alignas(64) slice
+	{
+		std::atomic<uint32_t> next{ 0 };
+		uint32_t end = 0;
+	};
+
+	void work(uint32_t worker);
+
+	void worker_loop(uint32_t worker);
+
+	const uint32_t worker_count_;
+	std::unique_ptr<slice[]> slices_;
+	std::vector<std::thread> threads_;
+
+	const std::function<void(uint32_t)>* job_ = nullptr;
+
+	std::mutex mutex_;
+	std::condition_variable start_;
+	std::condition_variable finished_;
+	uint64_t generation_ = 0;
+	uint32_t busy_ = 0;
+	bool exit_ = false;
+};
@@ -0,0 +1,857 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "base_object.h"
+#include "command_buffer.h"
+#include "engine_data.h"
+#include "math_core.h"
+#include "math_kernels.h"
+#include "mesh_loader.h"
+#include "pixel_kernels.h"
+#include "profiler.h"
+#include "renderer.h"
+#include "scene_graph.h"
+#include "soa_mesh.h"
+#include "texture.h"
+
+// Usage: Lab2Bench [--quick] [--output path] [--workers count] [--seed value]
+// Runs the renderer hot paths on fixed seeded scenes and writes the timings as JSON.
+
+namespace
+{
+	constexpr uint32_t width = 1280;
+	constexpr uint32_t height = 720;
+
+	struct bench_result
+	{
+		std::string name;
+		uint64_t iterations = 0;
+		double ns_per_op = 0;
+		double pixels_per_op = 0;
+		double frames_per_op = 0;
+		uint64_t checksum = 0;
+	};
+
+	// std::mt19937 output is fixed by the standard, the distributions are not, so values are mapped by hand.
+	class scene_random
+	{
+	public:
+		explicit scene_random(const uint32_t seed) : engine_(seed)
+		{
+		}
+
+		double next(const double low, const double high)
+		{
+			return low + (high - low) * (engine_() * (1.0 / 4294967296.0));
+		}
+
+		uint32_t next_color(const uint32_t alpha)
+		{
+			return alpha << 24 | (engine_() & 0x00FFFFFF);
+		}
+
+	private:
+		std::mt19937 engine_;
+	};
+
+	// Keeps the optimizer from dropping results that are never read.
+	volatile double sink;
+
+	struct bench_limits
+	{
+		double min_seconds;
+		uint64_t min_iterations;
+	};
+
+	// Times op(i) until both the iteration and time minimums are met, doubling the batch each round.
+	template <typename Op>
+	bench_result measure(const std::string& name, const bench_limits& limits, Op&& op)
+	{
+		using clock = std::chrono::steady_clock;
+
+		op(0);
+
+		uint64_t batch = 1;
+		uint64_t iterations = 0;
+		double seconds = 0;
+
+		while (seconds < limits.min_seconds || iterations < limits.min_iterations)
+		{
+			const auto start = clock::now();
+			for (uint64_t i = 0; i < batch; ++i) op(iterations + i);
+			seconds += std::chrono::duration<double>(clock::now() - start).count();
+
+			iterations += batch;
+			batch *= 2;
+		}
+
+		bench_result result;
+		result.name = name;
+		result.iterations = iterations;
+		result.ns_per_op = seconds * 1e9 / static_cast<double>(iterations);
+		return result;
+	}
+
+	uint64_t hash_frame(const uint32_t* pixels, const uint32_t count)
+	{
+		// FNV-1a over the packed pixels.
+		uint64_t hash = 14695981039346656037ull;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			hash = (hash ^ pixels[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	struct line_case
+	{
+		const char* slope;
+		double angle;
+	};
+
+	struct frame_scene
+	{
+		std::vector<vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<vec2> lines;
+	};
+
+	frame_scene build_scene(const uint32_t seed)
+	{
+		scene_random random{ seed };
+		frame_scene scene;
+
+		// 2000 small to medium triangles, a quarter of them translucent, plus 200 lines on top.
+		for (uint32_t i = 0; i < 2000; ++i)
+		{
+			const double cx = random.next(0, width);
+			const double cy = random.next(0, height);
+			const double size = random.next(8, 64);
+			const auto alpha = i % 4 == 0 ? 0x80u : 0xFFu;
+			const color c(random.next_color(alpha));
+
+			const auto base = static_cast<uint32_t>(scene.vertices.size());
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				scene.vertices.emplace_back(cx + random.next(-size, size), cy + random.next(-size, size), 0, 1, c);
+				scene.indices.push_back(base + corner);
+			}
+		}
+
+		for (uint32_t i = 0; i < 200; ++i)
+		{
+			scene.lines.emplace_back(random.next(0, width), random.next(0, height));
+			scene.lines.emplace_back(random.next(0, width), random.next(0, height));
+		}
+
+		return scene;
+	}
+
+	// 1500 large opaque triangles at one depth each, sorted front to back so most of them end up hidden.
+	frame_scene build_depth_scene(const uint32_t seed)
+	{
+		scene_random random{ seed };
+		frame_scene scene;
+		std::vector<std::pair<double, uint32_t>> order;
+
+		for (uint32_t i = 0; i < 1500; ++i)
+		{
+			const double cx = random.next(0, width);
+			const double cy = random.next(0, height);
+			const double size = random.next(64, 256);
+			const double z = random.next(0.01, 0.99);
+			const color c(random.next_color(0xFF));
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				scene.vertices.emplace_back(cx + random.next(-size, size), cy + random.next(-size, size), z, 1, c);
+			}
+			order.emplace_back(z, i);
+		}
+
+		std::sort(order.begin(), order.end());
+		for (const auto& entry : order)
+		{
+			for (uint32_t corner = 0; corner < 3; ++corner) scene.indices.push_back(entry.second * 3 + corner);
+		}
+
+		return scene;
+	}
+
+	// 4096 cubes on a 64 x 64 grid around the camera, only those in front of it fall inside the frustum.
+	// Corner i sits at -1 or 1 by bits 0, 1 and 2 of i, faces wind counter-clockwise seen from outside.
+	std::vector<base_object> build_world(const uint32_t seed)
+	{
+		scene_random random{ seed };
+		std::vector<base_object> world;
+		const uint32_t cube_indices[36] = {
+			4, 6, 2, 4, 2, 0, 1, 3, 7, 1, 7, 5, 0, 1, 5, 0, 5, 4, 6, 7, 3, 6, 3, 2, 2, 3, 1, 2, 1, 0, 4, 5, 7, 4, 7, 6
+		};
+
+		for (uint32_t i = 0; i < 64 * 64; ++i)
+		{
+			const color c(random.next_color(0xFF));
+
+			mesh_storage geometry(8, 36);
+			for (uint32_t corner = 0; corner < 8; ++corner)
+			{
+				geometry.get_vertices()[corner] = vertex(corner & 1 ? 1 : -1, corner & 2 ? 1 : -1, corner & 4 ? 1 : -1, 1,
+				                                         c);
+			}
+			std::copy_n(cube_indices, 36, geometry.get_indices());
+
+			const double x = (static_cast<double>(i % 64) - 31.5) * 6 + random.next(-1, 1);
+			const double z = (static_cast<double>(i / 64) - 31.5) * 6 + random.next(-1, 1);
+			world.emplace_back(std::move(geometry), mat_4::translation(x, random.next(-2, 2), z));
+		}
+
+		return world;
+	}
+
+	// A file in the system temp directory, named after this process so parallel runs don't collide, and
+	// removed when it goes out of scope.
+	struct temp_file
+	{
+		explicit temp_file(const char* name)
+		{
+#ifdef _WIN32
+			char directory[MAX_PATH + 1];
+			const DWORD length = GetTempPathA(sizeof(directory), directory);
+			path = length > 0 && length <= MAX_PATH ? std::string(directory, length) : std::string(".\\");
+			path += std::to_string(GetCurrentProcessId());
+#else
+			const char* directory = std::getenv("TMPDIR");
+			path = directory && *directory ? directory : "/tmp";
+			path += "/" + std::to_string(getpid());
+#endif
+			path += std::string("_") + name;
+		}
+
+		temp_file(const temp_file& other) = delete;
+
+		temp_file& operator=(const temp_file& other) = delete;
+
+		~temp_file() { std::remove(path.c_str()); }
+
+		const char* get() const { return path.c_str(); }
+
+		std::string path;
+	};
+
+	// A 256 x 256 vertex height field with texture coordinates as OBJ text, about 130k triangles.
+	bool write_grid_obj(const char* path, const uint32_t seed)
+	{
+		FILE* file = std::fopen(path, "w");
+		if (!file) return false;
+
+		scene_random random{ seed };
+		constexpr uint32_t size = 256;
+		for (uint32_t i = 0; i < size * size; ++i)
+		{
+			std::fprintf(file, "v %.6f %.6f %.6f\nvt %.6f %.6f\n", static_cast<double>(i % size), random.next(-1, 1),
+			             static_cast<double>(i / size), static_cast<double>(i % size) / (size - 1),
+			             static_cast<double>(i / size) / (size - 1));
+		}
+		for (uint32_t y = 0; y + 1 < size; ++y)
+		{
+			for (uint32_t x = 0; x + 1 < size; ++x)
+			{
+				const uint32_t corner = y * size + x + 1;
+				std::fprintf(file, "f %u/%u %u/%u %u/%u %u/%u\n", corner, corner, corner + size, corner + size,
+				             corner + size + 1, corner + size + 1, corner + 1, corner + 1);
+			}
+		}
+
+		return std::fclose(file) == 0;
+	}
+
+	void draw_scene(renderer& target, const frame_scene& scene)
+	{
+		target.clear_buffer();
+		target.draw_triangles(scene.vertices.data(), scene.indices.data(), static_cast<uint32_t>(scene.indices.size() / 3));
+		target.draw_lines(scene.lines.data(), static_cast<uint32_t>(scene.lines.size() / 2), 0xC0FFFFFF);
+		target.update_frame();
+	}
+
+	void write_json(FILE* out, const std::vector<bench_result>& results, const uint32_t seed, const uint32_t workers)
+	{
+		std::fprintf(out, "{\n  \"benchmark\": \"Lab2Bench\",\n  \"seed\": %u,\n  \"width\": %u,\n  \"height\": %u,\n", seed,
+		             width, height);
+		std::fprintf(out, "  \"workers\": %u,\n  \"kernels\": \"%s\",\n  \"results\": [\n", workers,
+		             pixel_kernels::get().name);
+
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const auto& r = results[i];
+			const double ops_per_second = 1e9 / r.ns_per_op;
+
+			std::fprintf(out, "    { \"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f", r.name.c_str(),
+			             static_cast<unsigned long long>(r.iterations), r.ns_per_op);
+			if (r.pixels_per_op > 0) std::fprintf(out, ", \"pixels_per_second\": %.0f", r.pixels_per_op * ops_per_second);
+			if (r.frames_per_op > 0) std::fprintf(out, ", \"frames_per_second\": %.2f", r.frames_per_op * ops_per_second);
+			if (r.checksum) std::fprintf(out, ", \"checksum\": \"%016llx\"", static_cast<unsigned long long>(r.checksum));
+			std::fprintf(out, " }%s\n", i + 1 < results.size() ? "," : "");
+		}
+
+		std::fprintf(out, "  ]\n}\n");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bench_limits limits{ 0.25, 64 };
+	const char* path = nullptr;
+	uint32_t workers = 0;
+	uint32_t seed = 0x1AB2;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--quick") == 0)
+			limits = { 0.01, 4 };
+		else if (i + 1 < argc && std::strcmp(argv[i], "--output") == 0)
+			path = argv[++i];
+		else if (i + 1 < argc && std::strcmp(argv[i], "--workers") == 0)
+			workers = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (i + 1 < argc && std::strcmp(argv[i], "--seed") == 0)
+			seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+	}
+
+	std::vector<bench_result> results;
+	renderer target{ width, height, color::cornflower_blue };
+	target.set_worker_count(1);
+
+	{
+		auto result = measure("clear_buffer", limits, [&](uint64_t) { target.clear_buffer(); });
+		result.pixels_per_op = width * height;
+		results.push_back(result);
+	}
+
+	{
+		// Translucent pixels at fixed positions, each op draws one.
+		scene_random random{ seed };
+		std::vector<uint32_t> pixels(4096), xs(4096), ys(4096);
+		for (uint32_t i = 0; i < 4096; ++i)
+		{
+			pixels[i] = random.next_color(static_cast<uint32_t>(random.next(1, 255)));
+			xs[i] = static_cast<uint32_t>(random.next(0, width));
+			ys[i] = static_cast<uint32_t>(random.next(0, height));
+		}
+
+		auto result = measure("draw_pixel_blend", limits, [&](const uint64_t i)
+		{
+			const auto k = i & 4095;
+			target.draw_pixel(pixels[k], xs[k], ys[k]);
+		});
+		result.pixels_per_op = 1;
+		results.push_back(result);
+	}
+
+	{
+		// Premultiplied sources composited over a row of the frame by each mode.
+		scene_random random{ seed };
+		std::vector<uint32_t> sources(width), row(width);
+		for (auto& source : sources)
+			source = pixel_kernels::premultiply(random.next_color(static_cast<uint32_t>(random.next(1, 255))));
+		for (auto& pixel : row) pixel = random.next_color(0xFF);
+
+		const std::pair<blend_mode, const char*> modes[] = {
+			{ blend_mode::over, "over" }, { blend_mode::add, "add" }, { blend_mode::multiply, "multiply" },
+			{ blend_mode::screen, "screen" }
+		};
+		const auto& kernels = pixel_kernels::get();
+		for (const auto& mode : modes)
+		{
+			auto result = measure(std::string("composite_span/") + mode.second, limits, [&](uint64_t)
+			{
+				kernels.composite(row.data(), sources.data(), width, mode.first);
+			});
+			result.pixels_per_op = width;
+			results.push_back(result);
+		}
+	}
+
+	const line_case slopes[] = {
+		{ "horizontal", 0 }, { "shallow", 15 }, { "diagonal", 45 }, { "steep", 75 }, { "vertical", 90 }
+	};
+	const double lengths[] = { 8, 64, 512 };
+
+	// Aliased, then smooth lines.
+	for (const auto mode : { line_mode::aliased, line_mode::smooth })
+	{
+		const std::string name = mode == line_mode::smooth ? "draw_line_smooth/" : "draw_line/";
+		target.set_line_mode(mode);
+		for (const auto& slope : slopes)
+		{
+			for (const auto length : lengths)
+			{
+				// Lines of one slope and length centered at random, all fully on screen, half drawn backwards.
+				scene_random random{ seed };
+				const double dx = std::cos(slope.angle * PI / 180) * length / 2;
+				const double dy = std::sin(slope.angle * PI / 180) * length / 2;
+				std::vector<vec2> points;
+				for (uint32_t i = 0; i < 256; ++i)
+				{
+					const double cx = random.next(std::abs(dx) + 1, width - std::abs(dx) - 1);
+					const double cy = random.next(std::abs(dy) + 1, height - std::abs(dy) - 1);
+					const double flip = i % 2 ? -1 : 1;
+					points.emplace_back(cx - dx * flip, cy - dy * flip);
+					points.emplace_back(cx + dx * flip, cy + dy * flip);
+				}
+
+				auto result = measure(name + slope.slope + "/" + std::to_string(static_cast<int>(length)),
+				                      limits, [&](const uint64_t i)
+				                      {
+					                      const auto k = (i & 255) * 2;
+					                      target.draw_line(points[k], points[k + 1], 0xFF00FF00);
+				                      });
+				result.pixels_per_op = std::round(std::max(std::abs(dx), std::abs(dy)) * 2) + 1;
+				results.push_back(result);
+			}
+		}
+	}
+	target.set_line_mode(line_mode::aliased);
+
+	{
+		scene_random random{ seed };
+		std::vector<mat_4> matrices(64);
+		std::vector<mat4f> matrices_f(64);
+		for (uint32_t i = 0; i < 64; ++i)
+		{
+			for (auto& row : matrices[i].m)
+			{
+				row = vec4(random.next(-1, 1), random.next(-1, 1), random.next(-1, 1), random.next(-1, 1));
+			}
+			matrices_f[i] = to_mat<float>(matrices[i]);
+		}
+
+		results.push_back(measure("mat_4_multiply", limits, [&](const uint64_t i)
+		{
+			const auto product = matrices[i & 63] * matrices[(i + 1) & 63];
+			sink = product.m[3][3];
+		}));
+
+		results.push_back(measure("mat4f_multiply", limits, [&](const uint64_t i)
+		{
+			const auto product = matrices_f[i & 63] * matrices_f[(i + 1) & 63];
+			sink = product[3][3];
+		}));
+	}
+
+	// Per vertex transform as geometry_stage runs it against the batched structure of arrays one.
+	{
+		scene_random random{ seed };
+		std::vector<vertex> vertices(4096);
+		std::vector<uint32_t> indices(4096);
+		for (uint32_t i = 0; i < 4096; ++i)
+		{
+			vertices[i] = vertex(random.next(-1, 1), random.next(-1, 1), random.next(-1, 1), 1, color(random.next_color(0xFF)));
+			indices[i] = i;
+		}
+
+		const mat_4 matrix = mat_4::perspective(1.0, static_cast<double>(width) / height, 0.1, 100) * mat_4::translation(0.5, -0.25, 4)
+			* mat_4::roll(0.3) * mat_4::pitch(0.7) * mat_4::yaw(1.1);
+		const base_object object(vertices.data(), 4096, indices.data(), 4096, matrix);
+		const soa_mesh in = object.build_mesh();
+		soa_mesh out;
+
+		const auto m = to_mat<double>(matrix);
+		std::vector<vec4d> expected(4096);
+
+		results.push_back(measure("transform_4096/aos", limits, [&](uint64_t)
+		{
+			const vertex* v = object.get_vertices();
+			for (uint32_t i = 0; i < 4096; ++i)
+			{
+				expected[i] = m * vec4d{ v[i].x, v[i].y, v[i].z, v[i].w };
+			}
+			sink = expected[4095][3];
+		}));
+
+		results.push_back(measure("transform_4096/soa", limits, [&](uint64_t)
+		{
+			soa_mesh::transform(matrix, in, out);
+			sink = out.w()[4095];
+		}));
+
+		// The batched kernels run in float, so they only have to agree to float precision.
+		for (uint32_t i = 0; i < 4096; ++i)
+		{
+			const double actual[4] = { out.x()[i], out.y()[i], out.z()[i], out.w()[i] };
+			for (int r = 0; r < 4; ++r)
+			{
+				if (std::abs(actual[r] - expected[i][r]) > 1e-4 * (1 + std::abs(expected[i][r])))
+				{
+					std::fprintf(stderr, "Batched transform differs from the per vertex one at vertex %u\n", i);
+					return 1;
+				}
+			}
+		}
+	}
+
+	// 64 chains of 64 nodes where only four nodes move per frame, against recomputing every world matrix.
+	{
+		scene_random random{ seed };
+		scene_graph graph;
+		std::vector<mat_4> relative_matrices;
+		for (uint32_t chain = 0; chain < 64; ++chain)
+		{
+			auto parent = scene_graph::no_parent;
+			for (uint32_t depth = 0; depth < 64; ++depth)
+			{
+				relative_matrices.push_back(mat_4::translation(random.next(-1, 1), random.next(-1, 1), random.next(-1, 1))
+					* mat_4::yaw(random.next(-1, 1)));
+				parent = graph.add_node(parent, relative_matrices.back());
+			}
+		}
+		graph.update();
+
+		const auto count = graph.get_node_count();
+		std::vector<mat_4> world_matrices(count);
+
+		// Parents always have lower ids, so one pass in id order sees every parent first.
+		const auto recompute = [&]
+		{
+			for (uint32_t node = 0; node < count; ++node)
+			{
+				const auto parent = graph.get_parent(node);
+				world_matrices[node] = parent == scene_graph::no_parent
+					                       ? graph.get_relative_matrix(node)
+					                       : world_matrices[parent] * graph.get_relative_matrix(node);
+			}
+		};
+
+		results.push_back(measure("scene_graph_4096/full", limits, [&](uint64_t)
+		{
+			recompute();
+			sink = world_matrices[count - 1].m[0][3];
+		}));
+
+		results.push_back(measure("scene_graph_4096/dirty_4", limits, [&](uint64_t)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				const auto node = static_cast<uint32_t>(random.next(0, count));
+				graph.set_relative_matrix(node, graph.get_relative_matrix(node) * mat_4::yaw(0.01));
+			}
+			graph.update();
+			sink = graph.get_updated_count();
+		}));
+
+		// Dirty propagation multiplies in the same order as the full pass, so the results match bit for bit.
+		// mat_4 equality allows an epsilon, the bytes are compared instead.
+		recompute();
+		for (uint32_t node = 0; node < count; ++node)
+		{
+			if (std::memcmp(&graph.get_world_matrix(node), &world_matrices[node], sizeof(mat_4)) != 0)
+			{
+				std::fprintf(stderr, "Scene graph update differs from a full recompute at node %u\n", node);
+				return 1;
+			}
+		}
+	}
+
+	// Rotation building per object and the math kernels over a batch of vertices.
+	{
+		scene_random random{ seed };
+		std::vector<float> angles(4096), sines(4096), cosines(4096), x(4096), y(4096), z(4096);
+		for (uint32_t i = 0; i < 4096; ++i)
+		{
+			angles[i] = static_cast<float>(random.next(-10, 10));
+			x[i] = static_cast<float>(random.next(-1, 1));
+			y[i] = static_cast<float>(random.next(-1, 1));
+			z[i] = static_cast<float>(random.next(-1, 1));
+		}
+
+		results.push_back(measure("rotation_build", limits, [&](const uint64_t i)
+		{
+			const double angle = angles[i & 4095];
+			sink = (mat_4::roll(angle) * mat_4::pitch(angle) * mat_4::yaw(angle)).m[0][0];
+		}));
+
+		results.push_back(measure("sincos_4096/std", limits, [&](uint64_t)
+		{
+			for (uint32_t i = 0; i < 4096; ++i)
+			{
+				sines[i] = std::sin(angles[i]);
+				cosines[i] = std::cos(angles[i]);
+			}
+			sink = sines[4095] + cosines[4095];
+		}));
+
+		results.push_back(measure("sincos_4096/span", limits, [&](uint64_t)
+		{
+			math_kernels::get().sincos_span(angles.data(), sines.data(), cosines.data(), 4096, approximation::precise);
+			sink = sines[4095] + cosines[4095];
+		}));
+
+		results.push_back(measure("normalize_4096/span", limits, [&](uint64_t)
+		{
+			math_kernels::get().normalize_span(x.data(), y.data(), z.data(), 4096);
+			sink = x[4095];
+		}));
+	}
+
+	// Cost of one enabled zone, the renderer's zones stay disabled everywhere else.
+	profiler::set_enabled(true);
+	results.push_back(measure("profile_zone", limits, [&](uint64_t) { LAB2_PROFILE_ZONE("bench"); }));
+	profiler::set_enabled(false);
+
+	// Full frames on one worker and on the requested count, the pictures have to match bit for bit.
+	const auto scene = build_scene(seed);
+	uint64_t checksums[2] = {};
+	const uint32_t frame_workers[2] = { 1, workers };
+
+	for (int run = 0; run < 2; ++run)
+	{
+		target.set_worker_count(frame_workers[run]);
+
+		auto result = measure("full_frame/workers_" + std::to_string(target.get_worker_count()), limits,
+		                      [&](uint64_t) { draw_scene(target, scene); });
+		result.pixels_per_op = width * height;
+		result.frames_per_op = 1;
+
+		draw_scene(target, scene);
+		result.checksum = checksums[run] = hash_frame(target.get_frame(), target.get_screen_size());
+		results.push_back(result);
+	}
+
+	// The same scene through the interpolating pixel pipeline.
+	{
+		target.set_shading(shading::vertex_color);
+		auto result = measure("full_frame/vertex_color", limits, [&](uint64_t) { draw_scene(target, scene); });
+		result.pixels_per_op = width * height;
+		result.frames_per_op = 1;
+		results.push_back(result);
+		target.set_shading(shading::flat);
+	}
+
+	// The same frame recorded once and replayed, it has to match the direct one.
+	{
+		command_buffer commands;
+		commands.clear_buffer();
+		commands.draw_triangles(scene.vertices.data(), scene.indices.data(), static_cast<uint32_t>(scene.indices.size() / 3));
+		commands.draw_lines(scene.lines.data(), static_cast<uint32_t>(scene.lines.size() / 2), 0xC0FFFFFF);
+
+		auto result = measure("full_frame/replay", limits, [&](uint64_t)
+		{
+			commands.execute(target);
+			target.update_frame();
+		});
+		result.pixels_per_op = width * height;
+		result.frames_per_op = 1;
+		result.checksum = hash_frame(target.get_frame(), target.get_screen_size());
+		results.push_back(result);
+
+		if (result.checksum != checksums[0])
+		{
+			std::fprintf(stderr, "Replayed frame differs from the direct one\n");
+			return 1;
+		}
+	}
+
+	// The same scene multisampled, only edge pixels store every sample and the resolve runs with update_frame.
+	for (const uint32_t samples : { 2u, 4u, 8u })
+	{
+		target.set_sample_count(samples);
+		auto result = measure("msaa_frame/" + std::to_string(samples) + "x", limits,
+		                      [&](uint64_t) { draw_scene(target, scene); });
+		result.pixels_per_op = width * height;
+		result.frames_per_op = 1;
+
+		draw_scene(target, scene);
+		result.checksum = hash_frame(target.get_frame(), target.get_screen_size());
+		results.push_back(result);
+	}
+	target.set_sample_count(1);
+
+	// A screen filling quad mapped turned by 90 degrees, so every row of pixels walks down a column of texels.
+	{
+		scene_random random{ seed };
+		constexpr uint32_t size = 1024;
+		std::vector<uint32_t> texels(size * size);
+		for (auto& texel : texels) texel = random.next_color(0xFF);
+
+		const double u = static_cast<double>(height) / size, v = static_cast<double>(width) / size;
+		const vertex quad[4] = {
+			vertex(0, 0, 0, 1, color(), 0, 0), vertex(width, 0, 0, 1, color(), 0, v),
+			vertex(width, height, 0, 1, color(), u, v), vertex(0, height, 0, 1, color(), u, 0)
+		};
+		const uint32_t quad_indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+		target.set_shading(shading::texture, blend_mode::replace);
+		for (const auto layout : { texture_layout::linear, texture_layout::morton })
+		{
+			texture image;
+			image.create(texels.data(), size, size, layout);
+			target.set_texture(&image);
+
+			auto result = measure(layout == texture_layout::linear ? "texture_frame/linear" : "texture_frame/morton", limits,
+			                      [&](uint64_t)
+			                      {
+				                      target.draw_triangles(quad, quad_indices, 2);
+				                      target.update_frame();
+			                      });
+			result.pixels_per_op = width * height;
+			result.frames_per_op = 1;
+			results.push_back(result);
+		}
+		target.set_texture(nullptr);
+		target.set_shading(shading::flat);
+	}
+
+	// A static scene with a small quad moving over it, redrawn whole and incrementally.
+	{
+		const auto cursor = [&](const uint64_t i)
+		{
+			const auto x = static_cast<double>(i * 7 % (width - 64));
+			const auto y = static_cast<double>(i * 3 % (height - 64));
+			const vertex quad[4] = {
+				vertex(x, y, 0, 1, color(0xC0FF0000u)),
+				vertex(x + 64, y, 0, 1, color(0xC0FF0000u)),
+				vertex(x + 64, y + 64, 0, 1, color(0xC0FF0000u)),
+				vertex(x, y + 64, 0, 1, color(0xC0FF0000u))
+			};
+			const uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+			target.draw_triangles(quad, indices, 2);
+		};
+		const auto bounds = [](const uint64_t i)
+		{
+			const auto x = static_cast<int32_t>(i * 7 % (width - 64));
+			const auto y = static_cast<int32_t>(i * 3 % (height - 64));
+			return screen_rect{ x, y, x + 65, y + 65 };
+		};
+
+		for (int incremental = 0; incremental < 2; ++incremental)
+		{
+			target.set_incremental(incremental != 0);
+			const char* name = incremental ? "overlay_frame/incremental" : "overlay_frame/full";
+			auto result = measure(name, limits, [&](const uint64_t i)
+			{
+				target.invalidate(bounds(i));
+				if (i > 0) target.invalidate(bounds(i - 1));
+				target.begin_frame();
+				target.clear_buffer();
+				target.draw_triangles(scene.vertices.data(), scene.indices.data(),
+				                      static_cast<uint32_t>(scene.indices.size() / 3));
+				cursor(i);
+				target.update_frame();
+			});
+			result.pixels_per_op = width * height;
+			result.frames_per_op = 1;
+			results.push_back(result);
+		}
+		target.set_incremental(false);
+	}
+
+	// High depth complexity, once with the depth test and hierarchical-Z, once painted back to front.
+	{
+		const auto depth_scene = build_depth_scene(seed);
+		auto back_to_front = depth_scene;
+		for (size_t i = 0; i < back_to_front.indices.size(); i += 3)
+		{
+			std::copy_n(depth_scene.indices.end() - i - 3, 3, back_to_front.indices.begin() + i);
+		}
+
+		target.set_depth_state(depth_compare::less, true);
+		auto result = measure("depth_frame/hi_z", limits, [&](uint64_t)
+		{
+			target.clear_depth();
+			draw_scene(target, depth_scene);
+		});
+		result.pixels_per_op = width * height;
+		result.frames_per_op = 1;
+		results.push_back(result);
+
+		target.set_depth_state(depth_compare::always, false);
+		result = measure("depth_frame/painter", limits, [&](uint64_t) { draw_scene(target, back_to_front); });
+		result.pixels_per_op = width * height;
+		result.frames_per_op = 1;
+		results.push_back(result);
+	}
+
+	// A large world seen through a perspective camera, most objects are culled by their bounding sphere.
+	{
+		const auto world = build_world(seed);
+		const auto view_projection = mat_4::perspective(1.0, static_cast<double>(width) / height, 0.5, 100);
+
+		target.set_depth_state(depth_compare::less, true);
+		target.set_cull_mode(cull_mode::back);
+		auto result = measure("world_frame/culled", limits, [&](uint64_t)
+		{
+			target.clear_buffer();
+			target.clear_depth();
+			for (const auto& object : world) target.draw_object(object, view_projection);
+			target.update_frame();
+		});
+		result.pixels_per_op = width * height;
+		result.frames_per_op = 1;
+		results.push_back(result);
+		target.set_cull_mode(cull_mode::none);
+		target.set_depth_state(depth_compare::always, false);
+	}
+
+	// Cold start of a large mesh, parsing OBJ text against mapping the binary cache and reading every index.
+	{
+		const temp_file obj_file("Lab2Bench_grid.obj");
+		const temp_file binary_file("Lab2Bench_grid.l2m");
+		const char* obj_path = obj_file.get();
+		const char* binary_path = binary_file.get();
+		std::vector<vertex> vertices;
+		std::vector<uint32_t> indices;
+
+		if (write_grid_obj(obj_path, seed) && mesh_loader::load_obj(obj_path, vertices, indices) &&
+			mesh_loader::write_binary(binary_path, vertices.data(), static_cast<uint32_t>(vertices.size()),
+			                          indices.data(), static_cast<uint32_t>(indices.size())))
+		{
+			auto result = measure("mesh_load/obj", limits, [&](uint64_t)
+			{
+				mesh_loader::load_obj(obj_path, vertices, indices);
+				sink = static_cast<double>(indices.size());
+			});
+			results.push_back(result);
+
+			result = measure("mesh_load/mapped", limits, [&](uint64_t)
+			{
+				mapped_mesh mesh;
+				mesh.open(binary_path);
+				uint64_t sum = 0;
+				for (uint32_t i = 0; i < mesh.get_view().index_count; ++i) sum += mesh.get_view().indices[i];
+				sink = static_cast<double>(sum);
+			});
+			results.push_back(result);
+		}
+	}
+
+	FILE* out = path ? std::fopen(path, "w") : stdout;
+	if (!out)
+	{
+		std::fprintf(stderr, "Could not open %s\n", path);
+		return 1;
+	}
+
+	write_json(out, results, seed, target.get_worker_count());
+	if (out != stdout) std::fclose(out);
+
+	if (checksums[0] != checksums[1])
+	{
+		std::fprintf(stderr, "Frames differ between worker counts\n");
+		return 1;
+	}
+}
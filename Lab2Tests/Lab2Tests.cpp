@@ -49,5 +49,83 @@ namespace Lab2Tests
 
 			Assert::IsTrue(test2, L"result*original did not match identity of 2x2 matrix.");
 		}
+
+		TEST_METHOD(blend_pixel_test)
+		{
+			// Opaque and transparent sources are exact.
+			Assert::AreEqual(0xFF123456u, pixel_kernels::blend_pixel(0xFF654321u, 0xFF123456u));
+			Assert::AreEqual(0xFF654321u, pixel_kernels::blend_pixel(0xFF654321u, 0x00123456u));
+
+			// Half white over black rounds to the nearest value.
+			Assert::AreEqual(0xFF808080u, pixel_kernels::blend_pixel(0xFF000000u, 0x80FFFFFFu));
+
+			for (uint32_t x = 0; x <= 255 * 255; ++x)
+			{
+				Assert::AreEqual(static_cast<uint32_t>(x / 255.0 + 0.5), pixel_kernels::div_255(x), L"div_255 is not exact.");
+			}
+		}
+
+		TEST_METHOD(composite_pixel_test)
+		{
+			Assert::AreEqual(0x80808080u, pixel_kernels::premultiply(0x80FFFFFFu));
+			Assert::AreEqual(0x00000000u, pixel_kernels::premultiply(0x00123456u));
+
+			// Half red over opaque black.
+			const uint32_t half_red = pixel_kernels::premultiply(0x80FF0000u);
+			Assert::AreEqual(0xFF800000u, pixel_kernels::composite_pixel<blend_mode::over>(0xFF000000u, half_red));
+
+			// Add saturates, multiply by white and screen with black leave the target.
+			Assert::AreEqual(0xFFFFFF20u, pixel_kernels::composite_pixel<blend_mode::add>(0xFFC0F010u, 0xFF802010u));
+			Assert::AreEqual(0xFF123456u, pixel_kernels::composite_pixel<blend_mode::multiply>(0xFF123456u, 0xFFFFFFFFu));
+			Assert::AreEqual(0xFF123456u, pixel_kernels::composite_pixel<blend_mode::screen>(0xFF123456u, 0xFF000000u));
+			Assert::AreEqual(0xFF000000u, pixel_kernels::composite_pixel<blend_mode::multiply>(0xFF123456u, 0xFF000000u));
+		}
+
+		TEST_METHOD(math_core_test)
+		{
+			constexpr auto rotation = mat4d::roll(0.5) * mat4d::pitch(0.25) * mat4d::translation(1, 2, 3);
+			static_assert(mat4d::identity() * rotation == rotation, "Identity builder is not constexpr.");
+
+			const auto single = to_mat<float>(to_mat_4(rotation));
+			const auto product = single * single;
+			const auto expected = rotation * rotation;
+
+			for (uint32_t r = 0; r < 4; ++r)
+				for (uint32_t c = 0; c < 4; ++c)
+					Assert::AreEqual(expected[r][c], static_cast<double>(product[r][c]), 1e-5, L"Single precision product does not match.");
+
+			const auto moved = single * vec4f{ 1, 1, 1, 1 };
+			const auto reference = rotation * vec4d{ 1, 1, 1, 1 };
+
+			for (uint32_t i = 0; i < 4; ++i)
+				Assert::AreEqual(reference[i], static_cast<double>(moved[i]), 1e-5, L"Single precision transform does not match.");
+		}
+
+		TEST_METHOD(math_kernels_test)
+		{
+			for (double angle = -20; angle <= 20; angle += 0.01)
+			{
+				double s, c;
+				math_kernels::sincos(angle, s, c);
+				Assert::AreEqual(std::sin(angle), s, 1e-15, L"Fused sine does not match.");
+				Assert::AreEqual(std::cos(angle), c, 1e-15, L"Fused cosine does not match.");
+			}
+
+			for (float x = 1e-3f; x < 1e3f; x *= 1.1f)
+			{
+				const double exact = 1 / std::sqrt(static_cast<double>(x));
+				Assert::AreEqual(exact, static_cast<double>(math_kernels::rsqrt(x, 0)), exact * 1e-3, L"Estimate is off.");
+				Assert::AreEqual(exact, static_cast<double>(math_kernels::rsqrt(x)), exact * 1e-6, L"Refined estimate is off.");
+			}
+
+			Assert::AreEqual(2.5f, math_kernels::lerp(2.0f, 4.0f, 0.25f));
+
+			// The builders match their constexpr counterparts, yaw keeps z.
+			const auto yaw = mat_4::yaw(0.75);
+			const auto reference = mat4d::yaw(0.75);
+			for (uint32_t r = 0; r < 4; ++r)
+				for (uint32_t c = 0; c < 4; ++c)
+					Assert::AreEqual(reference[r][c], yaw.m[r][c], 1e-12, L"Yaw does not match.");
+		}
 	};
 }
@@ -9,5 +9,7 @@
 
 // add headers that you want to pre-compile here
 #include "../Lab2/engine_data.h"
+#include "../Lab2/math_core.h"
+#include "../Lab2/pixel_kernels.h"
 
 #endif //PCH_H